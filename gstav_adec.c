@@ -9,6 +9,7 @@
  */
 
 #include "gstav_adec.h"
+#include "gstav_audioconv.h"
 #include "plugin.h"
 
 #include <libavcodec/avcodec.h>
@@ -23,9 +24,22 @@
 
 static GstElementClass *parent_class;
 
-#define BUFFER_SIZE AVCODEC_MAX_AUDIO_FRAME_SIZE
 #define MAX_DIFF 20 * 1000000
 
+/* decoded frames that fit in the ring, besides a pending chunk */
+#define RING_FRAMES 8
+
+#if LIBAVCODEC_VERSION_MAJOR >= 54 || (LIBAVCODEC_VERSION_MAJOR == 53 && LIBAVCODEC_VERSION_MINOR >= 25)
+#define HAVE_DECODE_AUDIO4
+#endif
+
+enum {
+	PROP_0,
+	PROP_CHUNK_DURATION,
+	PROP_INPUT_COPIES,
+	PROP_MEMORY_USAGE,
+};
+
 struct oggvorbis_private {
 	unsigned int len[3];
 	unsigned char *packet[3];
@@ -33,6 +47,7 @@ struct oggvorbis_private {
 
 struct ring {
 	size_t in, out;
+	size_t want; /* for the current frames */
 };
 
 struct obj {
@@ -43,14 +58,23 @@ struct obj {
 	bool got_header;
 	struct oggvorbis_private priv;
 	uint64_t timestamp;
-	AVPacket pkt;
+	uint8_t *pkt_data;
+	unsigned pkt_size;
+	guint input_copies;
+	GstBuffer *ring_buf;
+	GstBuffer *frame_buf;
+	bool no_pad_alloc;
 	uint8_t *buffer_data;
 	size_t buffer_size;
 	struct ring ring;
 	int (*header_func)(struct obj *self, GstBuffer *buf);
 	uint64_t next_timestamp;
 	int bps;
+	int out_fmt;
+	guint64 chunk_duration;
+	size_t chunk_size;
 	GMutex mutex;
+	gint flushing;
 };
 
 struct obj_class {
@@ -196,6 +220,385 @@ check_timestamps(struct obj *self, GstBuffer *buf)
 	}
 }
 
+/*
+ * Output buffers are sub-buffers of the ring, so the samples are not
+ * copied. When the ring is full, a new one is allocated, and only the
+ * samples not pushed yet are copied over; the old one is freed when
+ * downstream is done with it.
+ *
+ * The ring is sized from the decoded frames. Whenever nothing is pending
+ * and it's more than twice that size, it's dropped, so memory from bigger
+ * frames or stalled pushes is given back while streaming.
+ */
+static bool
+new_ring(struct obj *self, size_t size)
+{
+	GstBuffer *ring_buf;
+	size_t left = self->ring.in - self->ring.out;
+
+	ring_buf = gst_buffer_new();
+	GST_BUFFER_MALLOCDATA(ring_buf) = av_malloc(size);
+	GST_BUFFER_FREE_FUNC(ring_buf) = av_free;
+	GST_BUFFER_DATA(ring_buf) = GST_BUFFER_MALLOCDATA(ring_buf);
+	GST_BUFFER_SIZE(ring_buf) = size;
+
+	if (!ring_buf->data) {
+		gst_buffer_unref(ring_buf);
+		return false;
+	}
+
+	if (self->ring_buf) {
+		memcpy(ring_buf->data, self->buffer_data + self->ring.out, left);
+		gst_buffer_unref(self->ring_buf);
+	}
+
+	self->ring_buf = ring_buf;
+	self->buffer_data = ring_buf->data;
+	self->buffer_size = size;
+	self->ring.in = left;
+	self->ring.out = 0;
+
+	return true;
+}
+
+/* make room for a frame, growing the ring to hold 'frames' of them */
+static bool
+ring_reserve(struct obj *self, size_t size, unsigned frames)
+{
+	size_t left = self->ring.in - self->ring.out;
+
+	self->ring.want = frames * size + self->chunk_size;
+
+	if (self->ring_buf && self->ring.in + size <= self->buffer_size)
+		return true;
+
+	/* pending samples pile up when pushes fail */
+	if (!new_ring(self, MAX(self->ring.want, left + size)))
+		return false;
+
+	return self->ring.in + size <= self->buffer_size;
+}
+
+static void
+ring_trim(struct obj *self)
+{
+	if (!self->ring_buf || self->ring.in != self->ring.out)
+		return;
+
+	if (self->buffer_size <= 2 * self->ring.want)
+		return;
+
+	/* downstream keeps what it still uses */
+	gst_buffer_unref(self->ring_buf);
+	self->ring_buf = NULL;
+	self->buffer_data = NULL;
+	self->buffer_size = 0;
+	self->ring.in = self->ring.out = 0;
+}
+
+static void
+release_buffers(struct obj *self)
+{
+	if (self->ring_buf) {
+		gst_buffer_unref(self->ring_buf);
+		self->ring_buf = NULL;
+	}
+	self->buffer_data = NULL;
+	self->buffer_size = 0;
+	self->ring.in = self->ring.out = 0;
+
+	av_freep(&self->pkt_data);
+	self->pkt_size = 0;
+}
+
+static GstBuffer *
+ring_pop(struct obj *self, size_t size)
+{
+	GstBuffer *out_buf;
+
+	out_buf = gst_buffer_create_sub(self->ring_buf, self->ring.out, size);
+	calculate_timestamp(self, out_buf);
+	gst_buffer_set_caps(out_buf, self->srcpad->caps);
+
+	self->ring.out += size;
+
+	return out_buf;
+}
+
+/* bytes per output buffer, 0 for one per decoded frame */
+static void
+set_chunk_size(struct obj *self)
+{
+	AVCodecContext *ctx = self->av_ctx;
+	size_t frame_size = ctx->channels * (self->bps >> 3);
+	guint64 samples;
+
+	self->chunk_size = 0;
+	if (!self->chunk_duration || !frame_size)
+		return;
+
+	samples = gst_util_uint64_scale(self->chunk_duration, ctx->sample_rate, GST_SECOND);
+	if (!samples)
+		samples = 1;
+
+	/* bound what's held in the ring */
+	samples = MIN(samples, 2 * AVCODEC_MAX_AUDIO_FRAME_SIZE / frame_size);
+
+	self->chunk_size = samples * frame_size;
+}
+
+static bool
+set_src_caps(struct obj *self)
+{
+	AVCodecContext *av_ctx = self->av_ctx;
+	GstCaps *new_caps;
+	GstStructure *s;
+	int bps;
+	int fmt = av_ctx->sample_fmt;
+	bool is_float = false;
+
+#ifdef HAVE_DECODE_AUDIO4
+	/* planar output is interleaved */
+	switch (fmt) {
+	case AV_SAMPLE_FMT_S16P:
+		fmt = AV_SAMPLE_FMT_S16;
+		break;
+	case AV_SAMPLE_FMT_S32P:
+		fmt = AV_SAMPLE_FMT_S32;
+		break;
+	case AV_SAMPLE_FMT_FLTP:
+		fmt = AV_SAMPLE_FMT_FLT;
+		break;
+	default:
+		break;
+	}
+
+	if (fmt == AV_SAMPLE_FMT_FLT) {
+		new_caps = gst_caps_new_simple("audio/x-raw-float",
+				"rate", G_TYPE_INT, av_ctx->sample_rate,
+				"channels", G_TYPE_INT, av_ctx->channels,
+				"endianness", G_TYPE_INT, G_BYTE_ORDER,
+				"width", G_TYPE_INT, 32,
+				NULL);
+		is_float = gst_pad_peer_accept_caps(self->srcpad, new_caps);
+		gst_caps_unref(new_caps);
+
+		if (!is_float) {
+			GST_INFO_OBJECT(self, "downstream doesn't take float, converting");
+			fmt = AV_SAMPLE_FMT_S16;
+		}
+	}
+
+	if (fmt != AV_SAMPLE_FMT_S16 && fmt != AV_SAMPLE_FMT_S32 && !is_float) {
+		GST_ERROR_OBJECT(self, "unsupported sample format: %i", av_ctx->sample_fmt);
+		return false;
+	}
+#endif
+
+#if LIBAVUTIL_VERSION_MAJOR < 51
+	bps = av_get_bits_per_sample_format(fmt);
+#elif LIBAVUTIL_VERSION_MAJOR < 52 && !(LIBAVUTIL_VERSION_MAJOR == 51 && LIBAVUTIL_VERSION_MINOR >= 4)
+	bps = av_get_bits_per_sample_fmt(fmt);
+#else
+	bps = av_get_bytes_per_sample(fmt) << 3;
+#endif
+
+	self->bps = bps;
+	self->out_fmt = fmt;
+	set_chunk_size(self);
+
+	s = gst_structure_new(is_float ? "audio/x-raw-float" : "audio/x-raw-int",
+			"rate", G_TYPE_INT, av_ctx->sample_rate,
+			"channels", G_TYPE_INT, av_ctx->channels,
+			"endianness", G_TYPE_INT, G_BYTE_ORDER,
+			"width", G_TYPE_INT, bps,
+			NULL);
+
+	switch (fmt) {
+#if LIBAVCODEC_VERSION_MAJOR < 54
+	case SAMPLE_FMT_S16:
+	case SAMPLE_FMT_S32:
+#else
+	case AV_SAMPLE_FMT_S16:
+	case AV_SAMPLE_FMT_S32:
+#endif
+		gst_structure_set(s,
+				"signed", G_TYPE_BOOLEAN, TRUE,
+				"depth", G_TYPE_INT, bps,
+				NULL);
+		break;
+	default:
+		break;
+	}
+
+	new_caps = gst_caps_new_full(s, NULL);
+
+	GST_INFO_OBJECT(self, "caps are: %" GST_PTR_FORMAT, new_caps);
+	gst_pad_set_caps(self->srcpad, new_caps);
+	gst_caps_unref(new_caps);
+
+	return true;
+}
+
+#ifdef HAVE_DECODE_AUDIO4
+/* interleave, and convert to the negotiated format */
+static int
+copy_frame(struct obj *self, uint8_t *dst, AVFrame *frame)
+{
+	AVCodecContext *av_ctx = self->av_ctx;
+	int channels = av_ctx->channels;
+	int samples = frame->nb_samples;
+	int size = samples * channels * (self->bps >> 3);
+	const void *const *src = (const void *const *)frame->extended_data;
+
+	switch (av_ctx->sample_fmt) {
+	case AV_SAMPLE_FMT_S16P:
+		gst_av_interleave_16((int16_t *)dst, (const int16_t *const *)src, channels, samples);
+		break;
+	case AV_SAMPLE_FMT_S32P:
+		gst_av_interleave_32((int32_t *)dst, (const int32_t *const *)src, channels, samples);
+		break;
+	case AV_SAMPLE_FMT_FLTP:
+		if (self->out_fmt == AV_SAMPLE_FMT_FLT)
+			gst_av_interleave_32((int32_t *)dst, (const int32_t *const *)src, channels, samples);
+		else
+			gst_av_planar_float_to_s16((int16_t *)dst, (const float *const *)src, channels, samples);
+		break;
+	case AV_SAMPLE_FMT_FLT:
+		if (self->out_fmt == AV_SAMPLE_FMT_FLT)
+			memcpy(dst, src[0], size);
+		else
+			gst_av_float_to_s16((int16_t *)dst, src[0], samples * channels);
+		break;
+	default:
+		memcpy(dst, src[0], size);
+		break;
+	}
+
+	return size;
+}
+#endif
+
+/*
+ * Use the upstream memory directly when there's room for the padding, that's
+ * the case for sub-buffers demuxers take from bigger chunks; otherwise copy.
+ *
+ * The padding would be the start of the next packet instead of zeroes, which
+ * only the FLAC decoder is known to be fine with; MP3 and AAC could overread
+ * on damaged streams.
+ */
+static bool
+fill_packet(struct obj *self, AVPacket *pkt, GstBuffer *buf)
+{
+	GstBuffer *parent = buf->parent;
+
+	av_init_packet(pkt);
+	pkt->size = buf->size;
+
+	if (self->codec->id == CODEC_ID_FLAC && parent && buf->data >= parent->data &&
+			buf->data + buf->size + FF_INPUT_BUFFER_PADDING_SIZE <= parent->data + parent->size) {
+		pkt->data = buf->data;
+		return true;
+	}
+
+	/* don't hold on to the biggest packet seen */
+	if (self->pkt_size > 2 * (buf->size + FF_INPUT_BUFFER_PADDING_SIZE)) {
+		av_freep(&self->pkt_data);
+		self->pkt_size = 0;
+	}
+
+	av_fast_malloc(&self->pkt_data, &self->pkt_size, buf->size + FF_INPUT_BUFFER_PADDING_SIZE);
+	if (!self->pkt_data)
+		return false;
+
+	pkt->data = self->pkt_data;
+	memcpy(pkt->data, buf->data, buf->size);
+	memset(pkt->data + pkt->size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+	self->input_copies++;
+
+	return true;
+}
+
+#ifdef HAVE_DECODE_AUDIO4
+/*
+ * When the decoder output needs no conversion and no chunking, it decodes
+ * straight into a buffer from downstream, which is then pushed as is.
+ */
+static int
+get_buffer(AVCodecContext *ctx, AVFrame *frame)
+{
+	struct obj *self = ctx->opaque;
+	GstBuffer *out_buf = NULL;
+	int size;
+
+	if (ctx->sample_fmt != self->out_fmt || self->chunk_size ||
+			self->ring.in != self->ring.out)
+		return avcodec_default_get_buffer(ctx, frame);
+
+	size = av_samples_get_buffer_size(NULL, ctx->channels, frame->nb_samples,
+			ctx->sample_fmt, 32);
+	if (size < 0)
+		return size;
+
+	if (!self->no_pad_alloc && gst_pad_alloc_buffer(self->srcpad, 0, size,
+				self->srcpad->caps, &out_buf) != GST_FLOW_OK)
+		out_buf = NULL;
+
+	/* downstream suggested other caps */
+	if (out_buf && (!GST_BUFFER_CAPS(out_buf) ||
+				!gst_caps_is_equal(GST_BUFFER_CAPS(out_buf), self->srcpad->caps))) {
+		gst_buffer_unref(out_buf);
+		out_buf = NULL;
+	}
+
+	/* the decoder might use aligned stores; don't ask again */
+	if (out_buf && ((uintptr_t)out_buf->data & 31)) {
+		GST_INFO_OBJECT(self, "downstream buffers are not aligned");
+		self->no_pad_alloc = true;
+		gst_buffer_unref(out_buf);
+		out_buf = NULL;
+	}
+
+	if (!out_buf) {
+		out_buf = gst_buffer_new();
+		GST_BUFFER_MALLOCDATA(out_buf) = av_malloc(size);
+		GST_BUFFER_FREE_FUNC(out_buf) = av_free;
+		GST_BUFFER_DATA(out_buf) = GST_BUFFER_MALLOCDATA(out_buf);
+		GST_BUFFER_SIZE(out_buf) = size;
+		if (!out_buf->data) {
+			gst_buffer_unref(out_buf);
+			return -1;
+		}
+		gst_buffer_set_caps(out_buf, self->srcpad->caps);
+	}
+
+	if (self->frame_buf)
+		gst_buffer_unref(self->frame_buf);
+	self->frame_buf = out_buf;
+
+	frame->data[0] = out_buf->data;
+	frame->extended_data = frame->data;
+	frame->linesize[0] = size;
+	frame->opaque = out_buf;
+	frame->type = FF_BUFFER_TYPE_USER;
+
+	return 0;
+}
+
+static void
+release_buffer(AVCodecContext *ctx, AVFrame *frame)
+{
+	/* owned by frame_buf, or pushed already */
+	if (frame->type == FF_BUFFER_TYPE_USER) {
+		frame->data[0] = NULL;
+		frame->opaque = NULL;
+		return;
+	}
+
+	avcodec_default_release_buffer(ctx, frame);
+}
+#endif
+
 static GstFlowReturn
 pad_chain(GstPad *pad, GstBuffer *buf)
 {
@@ -206,70 +609,34 @@ pad_chain(GstPad *pad, GstBuffer *buf)
 	self = (struct obj *)((GstObject *)pad)->parent;
 	av_ctx = self->av_ctx;
 
+	if (g_atomic_int_get(&self->flushing)) {
+		ret = GST_FLOW_WRONG_STATE;
+		goto leave;
+	}
+
 	if (G_UNLIKELY(!self->got_header)) {
 		int hdr = self->header_func(self, buf);
 		if (!hdr) {
-			GstCaps *new_caps;
-			GstStructure *s;
-			int bps;
-
 			self->got_header = true;
 			if (gst_av_codec_open(av_ctx, self->codec) < 0) {
 				ret = GST_FLOW_ERROR;
 				goto leave;
 			}
 
-#if LIBAVUTIL_VERSION_MAJOR < 51
-			bps = av_get_bits_per_sample_format(av_ctx->sample_fmt);
-#elif LIBAVUTIL_VERSION_MAJOR < 52 && !(LIBAVUTIL_VERSION_MAJOR == 51 && LIBAVUTIL_VERSION_MINOR >= 4)
-			bps = av_get_bits_per_sample_fmt(av_ctx->sample_fmt);
-#else
-			bps = av_get_bytes_per_sample(av_ctx->sample_fmt) << 3;
-#endif
-
-			self->bps = bps;
-
-			s = gst_structure_new("audio/x-raw-int",
-					"rate", G_TYPE_INT, av_ctx->sample_rate,
-					"channels", G_TYPE_INT, av_ctx->channels,
-					"endianness", G_TYPE_INT, G_BYTE_ORDER,
-					"width", G_TYPE_INT, bps,
-					NULL);
-
-			switch (av_ctx->sample_fmt) {
-#if LIBAVCODEC_VERSION_MAJOR < 54
-			case SAMPLE_FMT_S16:
-			case SAMPLE_FMT_S32:
-#else
-			case AV_SAMPLE_FMT_S16:
-			case AV_SAMPLE_FMT_S32:
-#endif
-				gst_structure_set(s,
-						"signed", G_TYPE_BOOLEAN, TRUE,
-						"depth", G_TYPE_INT, bps,
-						NULL);
-				break;
-			default:
-				break;
+			if (!set_src_caps(self)) {
+				ret = GST_FLOW_NOT_NEGOTIATED;
+				goto leave;
 			}
-
-			new_caps = gst_caps_new_full(s, NULL);
-
-			GST_INFO_OBJECT(self, "caps are: %" GST_PTR_FORMAT, new_caps);
-			gst_pad_set_caps(self->srcpad, new_caps);
-			gst_caps_unref(new_caps);
 		}
 	}
 
 	if (G_LIKELY(self->got_header)) {
 		AVPacket pkt;
 
-		av_init_packet(&pkt);
-		pkt.data = self->pkt.data;
-		pkt.size = buf->size;
-
-		memcpy(pkt.data, buf->data, buf->size);
-		memset(pkt.data + pkt.size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+		if (!fill_packet(self, &pkt, buf)) {
+			ret = GST_FLOW_ERROR;
+			goto leave;
+		}
 
 		check_timestamps(self, buf);
 
@@ -280,11 +647,17 @@ pad_chain(GstPad *pad, GstBuffer *buf)
 			void *buffer_data;
 			int buffer_size;
 			int read;
-			unsigned total_buffer_size;
+			size_t total_buffer_size;
+
+#ifndef HAVE_DECODE_AUDIO4
+			if (!ring_reserve(self, AVCODEC_MAX_AUDIO_FRAME_SIZE, 2)) {
+				ret = GST_FLOW_ERROR;
+				break;
+			}
 
 			buffer_data = self->buffer_data + self->ring.in;
 			buffer_size = self->buffer_size - self->ring.in;
-#if LIBAVCODEC_VERSION_MAJOR < 54 && !(LIBAVCODEC_VERSION_MAJOR == 53 && LIBAVCODEC_VERSION_MINOR >= 25)
+
 			g_mutex_lock(&self->mutex);
 			read = avcodec_decode_audio3(av_ctx, buffer_data, &buffer_size, &pkt);
 			g_mutex_unlock(&self->mutex);
@@ -292,9 +665,15 @@ pad_chain(GstPad *pad, GstBuffer *buf)
 				GST_WARNING_OBJECT(self, "error: %i", read);
 				break;
 			}
+
+			/* a seek started while decoding, abandon the rest */
+			if (g_atomic_int_get(&self->flushing)) {
+				ret = GST_FLOW_WRONG_STATE;
+				break;
+			}
 #else
 			AVFrame frame;
-			int got_frame = 0, planar, plane_size;
+			int got_frame = 0;
 
 			g_mutex_lock(&self->mutex);
 			read = avcodec_decode_audio4(av_ctx, &frame, &got_frame, &pkt);
@@ -304,58 +683,68 @@ pad_chain(GstPad *pad, GstBuffer *buf)
 				break;
 			}
 
+			/* a seek started while decoding, abandon the rest */
+			if (g_atomic_int_get(&self->flushing)) {
+				ret = GST_FLOW_WRONG_STATE;
+				break;
+			}
+
 			if (!got_frame)
 				goto next;
 
-			planar = av_sample_fmt_is_planar(av_ctx->sample_fmt);
-			buffer_size = av_samples_get_buffer_size(&plane_size, av_ctx->channels,
-					frame.nb_samples, av_ctx->sample_fmt, 1);
+			if (self->frame_buf && frame.opaque == self->frame_buf) {
+				GstBuffer *out_buf = self->frame_buf;
+
+				self->frame_buf = NULL;
+				buffer_size = frame.nb_samples * av_ctx->channels * (self->bps >> 3);
+				GST_BUFFER_SIZE(out_buf) = buffer_size;
 
-			memcpy(buffer_data, frame.extended_data[0], plane_size);
+				if (buf->duration == GST_CLOCK_TIME_NONE)
+					self->next_timestamp += calculate_duration(self, buffer_size);
 
-			if (planar && av_ctx->channels > 1) {
-				uint8_t *out = ((uint8_t *)buffer_data) + plane_size;
-				for (int ch = 1; ch < av_ctx->channels; ch++) {
-					memcpy(out, frame.extended_data[ch], plane_size);
-					out += plane_size;
-				}
+				calculate_timestamp(self, out_buf);
+				ret = gst_pad_push(self->srcpad, out_buf);
+				goto next;
 			}
+
+			if (!ring_reserve(self, frame.nb_samples * av_ctx->channels * (self->bps >> 3), RING_FRAMES)) {
+				ret = GST_FLOW_ERROR;
+				break;
+			}
+
+			buffer_data = self->buffer_data + self->ring.in;
+			buffer_size = copy_frame(self, buffer_data, &frame);
 #endif
 
 			if (buf->duration == GST_CLOCK_TIME_NONE)
 				self->next_timestamp += calculate_duration(self, buffer_size);
 
 			self->ring.in += buffer_size;
-			if (self->ring.in >= 2 * AVCODEC_MAX_AUDIO_FRAME_SIZE) {
-				memmove(self->buffer_data,
-						self->buffer_data + self->ring.out,
-						self->ring.in - self->ring.out);
-				self->ring.in -= self->ring.out;
-				self->ring.out = 0;
-			}
 
-			if (BUFFER_SIZE > 0)
-				total_buffer_size = BUFFER_SIZE;
+			if (self->chunk_size)
+				total_buffer_size = self->chunk_size;
 			else
 				total_buffer_size = buffer_size;
 
-			if (self->ring.in - self->ring.out >= total_buffer_size) {
-				GstBuffer *out_buf;
-				out_buf = gst_buffer_new_and_alloc(total_buffer_size);
-				memcpy(out_buf->data, self->buffer_data + self->ring.out, out_buf->size);
-				calculate_timestamp(self, out_buf);
-				gst_buffer_set_caps(out_buf, self->srcpad->caps);
+			while (total_buffer_size && ret == GST_FLOW_OK &&
+					self->ring.in - self->ring.out >= total_buffer_size)
+				ret = gst_pad_push(self->srcpad, ring_pop(self, total_buffer_size));
 
-				self->ring.out += out_buf->size;
-
-				ret = gst_pad_push(self->srcpad, out_buf);
-			}
-#if LIBAVCODEC_VERSION_MAJOR >= 54 || (LIBAVCODEC_VERSION_MAJOR == 53 && LIBAVCODEC_VERSION_MINOR >= 25)
+			ring_trim(self);
+#ifdef HAVE_DECODE_AUDIO4
 next:
 #endif
 			pkt.size -= read;
 			pkt.data += read;
 		} while (pkt.size > 0);
+
+#ifdef HAVE_DECODE_AUDIO4
+		/* allocated but not used */
+		if (self->frame_buf) {
+			gst_buffer_unref(self->frame_buf);
+			self->frame_buf = NULL;
+		}
+#endif
 	}
 
 leave:
@@ -375,9 +764,9 @@ change_state(GstElement *element, GstStateChange transition)
 	switch (transition) {
 	case GST_STATE_CHANGE_NULL_TO_READY:
 		self->got_header = false;
-		av_new_packet(&self->pkt, AVCODEC_MAX_AUDIO_FRAME_SIZE);
-		self->buffer_size = 3 * AVCODEC_MAX_AUDIO_FRAME_SIZE;
-		self->buffer_data = av_malloc(self->buffer_size);
+		self->input_copies = 0;
+		self->no_pad_alloc = false;
+		self->ring.in = self->ring.out = 0;
 		break;
 
 	default:
@@ -396,8 +785,7 @@ change_state(GstElement *element, GstStateChange transition)
 			av_freep(&self->av_ctx->extradata);
 			av_freep(&self->av_ctx);
 		}
-		av_free_packet(&self->pkt);
-		av_freep(&self->buffer_data);
+		release_buffers(self);
 		break;
 
 	default:
@@ -417,26 +805,34 @@ sink_event(GstPad *pad, GstEvent *event)
 
 	switch (event->type) {
 	case GST_EVENT_FLUSH_START:
+		/*
+		 * The decode call in flight still completes, and the seek waits for
+		 * it on the stream lock; its output is dropped instead of pushed.
+		 */
+		g_atomic_int_set(&self->flushing, 1);
+		break;
+	case GST_EVENT_FLUSH_STOP:
+		/* the streaming thread is stopped by now */
 		self->timestamp = GST_CLOCK_TIME_NONE;
 		g_mutex_lock(&self->mutex);
-		avcodec_flush_buffers(self->av_ctx);
+		if (self->av_ctx)
+			avcodec_flush_buffers(self->av_ctx);
 		g_mutex_unlock(&self->mutex);
+		/* drop pending samples */
+		release_buffers(self);
+		g_atomic_int_set(&self->flushing, 0);
 		break;
 	case GST_EVENT_EOS: {
 		/* flush current buffer */
-		GstBuffer *out_buf;
 		GstFlowReturn r;
 
-		out_buf = gst_buffer_new_and_alloc(self->ring.in - self->ring.out);
-		memcpy(out_buf->data, self->buffer_data + self->ring.out, out_buf->size);
-		calculate_timestamp(self, out_buf);
-		gst_buffer_set_caps(out_buf, self->srcpad->caps);
-
-		self->ring.out += out_buf->size;
+		if (self->ring.in != self->ring.out) {
+			r = gst_pad_push(self->srcpad, ring_pop(self, self->ring.in - self->ring.out));
+			if (r != GST_FLOW_OK)
+				goto leave;
+		}
 
-		r = gst_pad_push(self->srcpad, out_buf);
-		if (r != GST_FLOW_OK)
-			goto leave;
+		release_buffers(self);
 		break;
 	}
 	default:
@@ -494,6 +890,14 @@ sink_setcaps(GstPad *pad, GstCaps *caps)
 
 	self->av_ctx = ctx = avcodec_alloc_context3(self->codec);
 
+#ifdef HAVE_DECODE_AUDIO4
+	if (self->codec->capabilities & CODEC_CAP_DR1) {
+		ctx->opaque = self;
+		ctx->get_buffer = get_buffer;
+		ctx->release_buffer = release_buffer;
+	}
+#endif
+
 	switch (codec_id) {
 	case CODEC_ID_VORBIS:
 		self->header_func = vorbis_header;
@@ -558,6 +962,15 @@ generate_src_template(void)
 			"channels", GST_TYPE_INT_RANGE, 1, 256,
 			NULL);
 
+#ifdef HAVE_DECODE_AUDIO4
+	gst_caps_append_structure(caps, gst_structure_new("audio/x-raw-float",
+			"rate", GST_TYPE_INT_RANGE, 8000, 96000,
+			"endianness", G_TYPE_INT, G_BYTE_ORDER,
+			"width", G_TYPE_INT, 32,
+			"channels", GST_TYPE_INT_RANGE, 1, 256,
+			NULL));
+#endif
+
 	return caps;
 }
 
@@ -633,6 +1046,42 @@ finalize(GObject *obj)
 	((GObjectClass *)parent_class)->finalize(obj);
 }
 
+static void
+set_property(GObject *obj, guint prop_id, const GValue *value, GParamSpec *pspec)
+{
+	struct obj *self = (struct obj *)obj;
+
+	switch (prop_id) {
+	case PROP_CHUNK_DURATION:
+		self->chunk_duration = g_value_get_uint64(value);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+get_property(GObject *obj, guint prop_id, GValue *value, GParamSpec *pspec)
+{
+	struct obj *self = (struct obj *)obj;
+
+	switch (prop_id) {
+	case PROP_CHUNK_DURATION:
+		g_value_set_uint64(value, self->chunk_duration);
+		break;
+	case PROP_INPUT_COPIES:
+		g_value_set_uint(value, self->input_copies);
+		break;
+	case PROP_MEMORY_USAGE:
+		g_value_set_uint64(value, sizeof(*self) + self->buffer_size + self->pkt_size);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+		break;
+	}
+}
+
 static void
 base_init(void *g_class)
 {
@@ -668,6 +1117,23 @@ class_init(void *g_class, void *class_data)
 
 	gstelement_class->change_state = change_state;
 	gobject_class->finalize = finalize;
+	gobject_class->set_property = set_property;
+	gobject_class->get_property = get_property;
+
+	g_object_class_install_property(gobject_class, PROP_CHUNK_DURATION,
+			g_param_spec_uint64("chunk-duration", "Chunk duration",
+				"Duration of each output buffer (ns, 0 = one per decoded frame)",
+				0, GST_SECOND, 0, G_PARAM_READWRITE));
+
+	g_object_class_install_property(gobject_class, PROP_INPUT_COPIES,
+			g_param_spec_uint("input-copies", "Input copies",
+				"Number of input buffers that had to be copied",
+				0, G_MAXUINT, 0, G_PARAM_READABLE));
+
+	g_object_class_install_property(gobject_class, PROP_MEMORY_USAGE,
+			g_param_spec_uint64("memory-usage", "Memory usage",
+				"Bytes held by the element for its buffers (decoder state excluded)",
+				0, G_MAXUINT64, 0, G_PARAM_READABLE));
 }
 
 GType
@@ -0,0 +1,517 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Author: agent <agent@local>
+ *
+ * This file may be used under the terms of the GNU Lesser General Public
+ * License version 2.1, a copy of which is found in LICENSE included in the
+ * packaging of this file.
+ */
+
+#include "gstav_audioconv.h"
+
+#include <glib.h>
+
+static inline int16_t float_to_s16(float v)
+{
+	v *= 32768.0f;
+	if (v >= 32767.0f)
+		return 32767;
+	if (v <= -32768.0f)
+		return -32768;
+	return (int16_t)v;
+}
+
+/* generic versions */
+
+static void interleave_16_c(int16_t *dst, const int16_t *const *src, int channels, int samples)
+{
+	for (int c = 0; c < channels; c++) {
+		const int16_t *s = src[c];
+		int16_t *d = dst + c;
+		for (int i = 0; i < samples; i++, d += channels)
+			*d = s[i];
+	}
+}
+
+static void interleave_32_c(int32_t *dst, const int32_t *const *src, int channels, int samples)
+{
+	for (int c = 0; c < channels; c++) {
+		const int32_t *s = src[c];
+		int32_t *d = dst + c;
+		for (int i = 0; i < samples; i++, d += channels)
+			*d = s[i];
+	}
+}
+
+static void float_to_s16_c(int16_t *dst, const float *src, int n)
+{
+	for (int i = 0; i < n; i++)
+		dst[i] = float_to_s16(src[i]);
+}
+
+static void planar_float_to_s16_c(int16_t *dst, const float *const *src, int channels, int samples)
+{
+	for (int c = 0; c < channels; c++) {
+		const float *s = src[c];
+		int16_t *d = dst + c;
+		for (int i = 0; i < samples; i++, d += channels)
+			*d = float_to_s16(s[i]);
+	}
+}
+
+/* one channel, from sample 'from' on */
+
+static inline void tail_16(int16_t *dst, const int16_t *s, int channels, int from, int samples)
+{
+	for (int i = from; i < samples; i++)
+		dst[i * channels] = s[i];
+}
+
+static inline void tail_32(int32_t *dst, const int32_t *s, int channels, int from, int samples)
+{
+	for (int i = from; i < samples; i++)
+		dst[i * channels] = s[i];
+}
+
+static inline void tail_float(int16_t *dst, const float *s, int channels, int from, int samples)
+{
+	for (int i = from; i < samples; i++)
+		dst[i * channels] = float_to_s16(s[i]);
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86
+
+#include <immintrin.h>
+
+/*
+ * SSE2
+ *
+ * Channels are handled in groups of four with a transpose, the rest one
+ * by one, or in pairs for 32-bit. Stereo is stored contiguously.
+ */
+
+/* 8 samples of 4 channels */
+__attribute__((target("sse2")))
+static inline void store_4x8_16(int16_t *d, int channels,
+		__m128i a, __m128i b, __m128i c, __m128i e)
+{
+	__m128i t0 = _mm_unpacklo_epi16(a, b);
+	__m128i t1 = _mm_unpacklo_epi16(c, e);
+	__m128i t2 = _mm_unpackhi_epi16(a, b);
+	__m128i t3 = _mm_unpackhi_epi16(c, e);
+	__m128i r[4];
+
+	r[0] = _mm_unpacklo_epi32(t0, t1);
+	r[1] = _mm_unpackhi_epi32(t0, t1);
+	r[2] = _mm_unpacklo_epi32(t2, t3);
+	r[3] = _mm_unpackhi_epi32(t2, t3);
+
+	for (int k = 0; k < 4; k++) {
+		_mm_storel_epi64((__m128i *)d, r[k]);
+		d += channels;
+		_mm_storel_epi64((__m128i *)d, _mm_srli_si128(r[k], 8));
+		d += channels;
+	}
+}
+
+/* 8 floats to S16 */
+__attribute__((target("sse2")))
+static inline __m128i cvt_8_sse2(const float *s)
+{
+	const __m128 scale = _mm_set1_ps(32768.0f);
+	const __m128 max = _mm_set1_ps(32767.0f);
+	const __m128 min = _mm_set1_ps(-32768.0f);
+	__m128 a = _mm_mul_ps(_mm_loadu_ps(s), scale);
+	__m128 b = _mm_mul_ps(_mm_loadu_ps(s + 4), scale);
+
+	a = _mm_max_ps(_mm_min_ps(a, max), min);
+	b = _mm_max_ps(_mm_min_ps(b, max), min);
+	return _mm_packs_epi32(_mm_cvttps_epi32(a), _mm_cvttps_epi32(b));
+}
+
+__attribute__((target("sse2")))
+static void interleave_16_sse2(int16_t *dst, const int16_t *const *src, int channels, int samples)
+{
+	int c = 0, i;
+
+	if (channels == 2) {
+		const int16_t *l = src[0], *r = src[1];
+		for (i = 0; i + 8 <= samples; i += 8) {
+			__m128i a = _mm_loadu_si128((const __m128i *)(l + i));
+			__m128i b = _mm_loadu_si128((const __m128i *)(r + i));
+			_mm_storeu_si128((__m128i *)(dst + 2 * i), _mm_unpacklo_epi16(a, b));
+			_mm_storeu_si128((__m128i *)(dst + 2 * i + 8), _mm_unpackhi_epi16(a, b));
+		}
+		tail_16(dst, l, 2, i, samples);
+		tail_16(dst + 1, r, 2, i, samples);
+		return;
+	}
+
+	for (; c + 4 <= channels; c += 4) {
+		for (i = 0; i + 8 <= samples; i += 8)
+			store_4x8_16(dst + i * channels + c, channels,
+					_mm_loadu_si128((const __m128i *)(src[c] + i)),
+					_mm_loadu_si128((const __m128i *)(src[c + 1] + i)),
+					_mm_loadu_si128((const __m128i *)(src[c + 2] + i)),
+					_mm_loadu_si128((const __m128i *)(src[c + 3] + i)));
+		for (int k = 0; k < 4; k++)
+			tail_16(dst + c + k, src[c + k], channels, i, samples);
+	}
+
+	for (; c < channels; c++)
+		tail_16(dst + c, src[c], channels, 0, samples);
+}
+
+__attribute__((target("sse2")))
+static void interleave_32_sse2(int32_t *dst, const int32_t *const *src, int channels, int samples)
+{
+	int c = 0, i;
+
+	for (; c + 4 <= channels; c += 4) {
+		const int32_t *s0 = src[c], *s1 = src[c + 1], *s2 = src[c + 2], *s3 = src[c + 3];
+		for (i = 0; i + 4 <= samples; i += 4) {
+			__m128i a = _mm_loadu_si128((const __m128i *)(s0 + i));
+			__m128i b = _mm_loadu_si128((const __m128i *)(s1 + i));
+			__m128i e = _mm_loadu_si128((const __m128i *)(s2 + i));
+			__m128i f = _mm_loadu_si128((const __m128i *)(s3 + i));
+			__m128i t0 = _mm_unpacklo_epi32(a, b);
+			__m128i t1 = _mm_unpacklo_epi32(e, f);
+			__m128i t2 = _mm_unpackhi_epi32(a, b);
+			__m128i t3 = _mm_unpackhi_epi32(e, f);
+			int32_t *d = dst + i * channels + c;
+
+			_mm_storeu_si128((__m128i *)d, _mm_unpacklo_epi64(t0, t1));
+			d += channels;
+			_mm_storeu_si128((__m128i *)d, _mm_unpackhi_epi64(t0, t1));
+			d += channels;
+			_mm_storeu_si128((__m128i *)d, _mm_unpacklo_epi64(t2, t3));
+			d += channels;
+			_mm_storeu_si128((__m128i *)d, _mm_unpackhi_epi64(t2, t3));
+		}
+		for (int k = 0; k < 4; k++)
+			tail_32(dst + c + k, src[c + k], channels, i, samples);
+	}
+
+	if (c + 2 <= channels) {
+		const int32_t *s0 = src[c], *s1 = src[c + 1];
+		for (i = 0; i + 4 <= samples; i += 4) {
+			__m128i a = _mm_loadu_si128((const __m128i *)(s0 + i));
+			__m128i b = _mm_loadu_si128((const __m128i *)(s1 + i));
+			__m128i lo = _mm_unpacklo_epi32(a, b);
+			__m128i hi = _mm_unpackhi_epi32(a, b);
+			int32_t *d = dst + i * channels + c;
+
+			if (channels == 2) {
+				_mm_storeu_si128((__m128i *)d, lo);
+				_mm_storeu_si128((__m128i *)(d + 4), hi);
+				continue;
+			}
+			_mm_storel_epi64((__m128i *)d, lo);
+			d += channels;
+			_mm_storel_epi64((__m128i *)d, _mm_srli_si128(lo, 8));
+			d += channels;
+			_mm_storel_epi64((__m128i *)d, hi);
+			d += channels;
+			_mm_storel_epi64((__m128i *)d, _mm_srli_si128(hi, 8));
+		}
+		tail_32(dst + c, s0, channels, i, samples);
+		tail_32(dst + c + 1, s1, channels, i, samples);
+		c += 2;
+	}
+
+	for (; c < channels; c++)
+		tail_32(dst + c, src[c], channels, 0, samples);
+}
+
+__attribute__((target("sse2")))
+static void float_to_s16_sse2(int16_t *dst, const float *src, int n)
+{
+	int i;
+
+	for (i = 0; i + 8 <= n; i += 8)
+		_mm_storeu_si128((__m128i *)(dst + i), cvt_8_sse2(src + i));
+	float_to_s16_c(dst + i, src + i, n - i);
+}
+
+__attribute__((target("sse2")))
+static void planar_float_to_s16_sse2(int16_t *dst, const float *const *src, int channels, int samples)
+{
+	int c = 0, i;
+
+	if (channels == 1) {
+		float_to_s16_sse2(dst, src[0], samples);
+		return;
+	}
+
+	if (channels == 2) {
+		const float *l = src[0], *r = src[1];
+		for (i = 0; i + 8 <= samples; i += 8) {
+			__m128i a = cvt_8_sse2(l + i);
+			__m128i b = cvt_8_sse2(r + i);
+			_mm_storeu_si128((__m128i *)(dst + 2 * i), _mm_unpacklo_epi16(a, b));
+			_mm_storeu_si128((__m128i *)(dst + 2 * i + 8), _mm_unpackhi_epi16(a, b));
+		}
+		tail_float(dst, l, 2, i, samples);
+		tail_float(dst + 1, r, 2, i, samples);
+		return;
+	}
+
+	for (; c + 4 <= channels; c += 4) {
+		for (i = 0; i + 8 <= samples; i += 8)
+			store_4x8_16(dst + i * channels + c, channels,
+					cvt_8_sse2(src[c] + i),
+					cvt_8_sse2(src[c + 1] + i),
+					cvt_8_sse2(src[c + 2] + i),
+					cvt_8_sse2(src[c + 3] + i));
+		for (int k = 0; k < 4; k++)
+			tail_float(dst + c + k, src[c + k], channels, i, samples);
+	}
+
+	for (; c < channels; c++)
+		tail_float(dst + c, src[c], channels, 0, samples);
+}
+
+/* AVX2; only the float conversions gain from the wider registers */
+
+/* 16 floats to S16 */
+__attribute__((target("avx2")))
+static inline __m256i cvt_16_avx2(const float *s)
+{
+	const __m256 scale = _mm256_set1_ps(32768.0f);
+	const __m256 max = _mm256_set1_ps(32767.0f);
+	const __m256 min = _mm256_set1_ps(-32768.0f);
+	__m256 a = _mm256_mul_ps(_mm256_loadu_ps(s), scale);
+	__m256 b = _mm256_mul_ps(_mm256_loadu_ps(s + 8), scale);
+	__m256i v;
+
+	a = _mm256_max_ps(_mm256_min_ps(a, max), min);
+	b = _mm256_max_ps(_mm256_min_ps(b, max), min);
+	v = _mm256_packs_epi32(_mm256_cvttps_epi32(a), _mm256_cvttps_epi32(b));
+	/* packs works within 128-bit lanes */
+	return _mm256_permute4x64_epi64(v, 0xd8);
+}
+
+__attribute__((target("avx2")))
+static void float_to_s16_avx2(int16_t *dst, const float *src, int n)
+{
+	int i;
+
+	for (i = 0; i + 16 <= n; i += 16)
+		_mm256_storeu_si256((__m256i *)(dst + i), cvt_16_avx2(src + i));
+	float_to_s16_sse2(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void planar_float_to_s16_avx2(int16_t *dst, const float *const *src, int channels, int samples)
+{
+	const float *l, *r;
+	int i;
+
+	if (channels == 1) {
+		float_to_s16_avx2(dst, src[0], samples);
+		return;
+	}
+
+	if (channels != 2) {
+		planar_float_to_s16_sse2(dst, src, channels, samples);
+		return;
+	}
+
+	l = src[0];
+	r = src[1];
+	for (i = 0; i + 16 <= samples; i += 16) {
+		__m256i a = cvt_16_avx2(l + i);
+		__m256i b = cvt_16_avx2(r + i);
+		__m256i lo = _mm256_unpacklo_epi16(a, b);
+		__m256i hi = _mm256_unpackhi_epi16(a, b);
+		_mm256_storeu_si256((__m256i *)(dst + 2 * i), _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i *)(dst + 2 * i + 16), _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+	tail_float(dst, l, 2, i, samples);
+	tail_float(dst + 1, r, 2, i, samples);
+}
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define HAVE_NEON
+
+#include <arm_neon.h>
+
+/* NEON; the structured stores interleave two to four channels */
+
+static inline int16x8_t cvt_8_neon(const float *s)
+{
+	/* the conversion saturates */
+	int32x4_t a = vcvtq_s32_f32(vmulq_n_f32(vld1q_f32(s), 32768.0f));
+	int32x4_t b = vcvtq_s32_f32(vmulq_n_f32(vld1q_f32(s + 4), 32768.0f));
+	return vcombine_s16(vqmovn_s32(a), vqmovn_s32(b));
+}
+
+static void interleave_16_neon(int16_t *dst, const int16_t *const *src, int channels, int samples)
+{
+	int i;
+
+	switch (channels) {
+	case 2:
+		for (i = 0; i + 8 <= samples; i += 8) {
+			int16x8x2_t v;
+			v.val[0] = vld1q_s16(src[0] + i);
+			v.val[1] = vld1q_s16(src[1] + i);
+			vst2q_s16(dst + 2 * i, v);
+		}
+		break;
+	case 4:
+		for (i = 0; i + 8 <= samples; i += 8) {
+			int16x8x4_t v;
+			for (int k = 0; k < 4; k++)
+				v.val[k] = vld1q_s16(src[k] + i);
+			vst4q_s16(dst + 4 * i, v);
+		}
+		break;
+	default:
+		interleave_16_c(dst, src, channels, samples);
+		return;
+	}
+
+	for (int k = 0; k < channels; k++)
+		tail_16(dst + k, src[k], channels, i, samples);
+}
+
+static void interleave_32_neon(int32_t *dst, const int32_t *const *src, int channels, int samples)
+{
+	int i;
+
+	switch (channels) {
+	case 2:
+		for (i = 0; i + 4 <= samples; i += 4) {
+			int32x4x2_t v;
+			v.val[0] = vld1q_s32(src[0] + i);
+			v.val[1] = vld1q_s32(src[1] + i);
+			vst2q_s32(dst + 2 * i, v);
+		}
+		break;
+	case 4:
+		for (i = 0; i + 4 <= samples; i += 4) {
+			int32x4x4_t v;
+			for (int k = 0; k < 4; k++)
+				v.val[k] = vld1q_s32(src[k] + i);
+			vst4q_s32(dst + 4 * i, v);
+		}
+		break;
+	default:
+		interleave_32_c(dst, src, channels, samples);
+		return;
+	}
+
+	for (int k = 0; k < channels; k++)
+		tail_32(dst + k, src[k], channels, i, samples);
+}
+
+static void float_to_s16_neon(int16_t *dst, const float *src, int n)
+{
+	int i;
+
+	for (i = 0; i + 8 <= n; i += 8)
+		vst1q_s16(dst + i, cvt_8_neon(src + i));
+	float_to_s16_c(dst + i, src + i, n - i);
+}
+
+static void planar_float_to_s16_neon(int16_t *dst, const float *const *src, int channels, int samples)
+{
+	int i;
+
+	switch (channels) {
+	case 1:
+		float_to_s16_neon(dst, src[0], samples);
+		return;
+	case 2:
+		for (i = 0; i + 8 <= samples; i += 8) {
+			int16x8x2_t v;
+			v.val[0] = cvt_8_neon(src[0] + i);
+			v.val[1] = cvt_8_neon(src[1] + i);
+			vst2q_s16(dst + 2 * i, v);
+		}
+		break;
+	case 4:
+		for (i = 0; i + 8 <= samples; i += 8) {
+			int16x8x4_t v;
+			for (int k = 0; k < 4; k++)
+				v.val[k] = cvt_8_neon(src[k] + i);
+			vst4q_s16(dst + 4 * i, v);
+		}
+		break;
+	default:
+		planar_float_to_s16_c(dst, src, channels, samples);
+		return;
+	}
+
+	for (int k = 0; k < channels; k++)
+		tail_float(dst + k, src[k], channels, i, samples);
+}
+#endif
+
+static struct {
+	void (*interleave_16)(int16_t *dst, const int16_t *const *src, int channels, int samples);
+	void (*interleave_32)(int32_t *dst, const int32_t *const *src, int channels, int samples);
+	void (*float_to_s16)(int16_t *dst, const float *src, int n);
+	void (*planar_float_to_s16)(int16_t *dst, const float *const *src, int channels, int samples);
+} funcs;
+
+static void init(void)
+{
+	static gsize once;
+
+	if (!g_once_init_enter(&once))
+		return;
+
+	funcs.interleave_16 = interleave_16_c;
+	funcs.interleave_32 = interleave_32_c;
+	funcs.float_to_s16 = float_to_s16_c;
+	funcs.planar_float_to_s16 = planar_float_to_s16_c;
+
+#if defined(HAVE_X86)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2")) {
+		funcs.interleave_16 = interleave_16_sse2;
+		funcs.interleave_32 = interleave_32_sse2;
+		funcs.float_to_s16 = float_to_s16_sse2;
+		funcs.planar_float_to_s16 = planar_float_to_s16_sse2;
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		funcs.float_to_s16 = float_to_s16_avx2;
+		funcs.planar_float_to_s16 = planar_float_to_s16_avx2;
+	}
+#elif defined(HAVE_NEON)
+	funcs.interleave_16 = interleave_16_neon;
+	funcs.interleave_32 = interleave_32_neon;
+	funcs.float_to_s16 = float_to_s16_neon;
+	funcs.planar_float_to_s16 = planar_float_to_s16_neon;
+#endif
+
+	g_once_init_leave(&once, 1);
+}
+
+void gst_av_interleave_16(int16_t *dst, const int16_t *const *src, int channels, int samples)
+{
+	init();
+	funcs.interleave_16(dst, src, channels, samples);
+}
+
+void gst_av_interleave_32(int32_t *dst, const int32_t *const *src, int channels, int samples)
+{
+	init();
+	funcs.interleave_32(dst, src, channels, samples);
+}
+
+void gst_av_float_to_s16(int16_t *dst, const float *src, int n)
+{
+	init();
+	funcs.float_to_s16(dst, src, n);
+}
+
+void gst_av_planar_float_to_s16(int16_t *dst, const float *const *src, int channels, int samples)
+{
+	init();
+	funcs.planar_float_to_s16(dst, src, channels, samples);
+}
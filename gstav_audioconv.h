@@ -0,0 +1,24 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Author: agent <agent@local>
+ *
+ * This file may be used under the terms of the GNU Lesser General Public
+ * License version 2.1, a copy of which is found in LICENSE included in the
+ * packaging of this file.
+ */
+
+#ifndef GST_AV_AUDIOCONV_H
+#define GST_AV_AUDIOCONV_H
+
+#include <stdint.h>
+
+/* planar to interleaved */
+void gst_av_interleave_16(int16_t *dst, const int16_t *const *src, int channels, int samples);
+void gst_av_interleave_32(int32_t *dst, const int32_t *const *src, int channels, int samples);
+
+/* float to S16, with clipping */
+void gst_av_float_to_s16(int16_t *dst, const float *src, int n);
+void gst_av_planar_float_to_s16(int16_t *dst, const float *const *src, int channels, int samples);
+
+#endif /* GST_AV_AUDIOCONV_H */
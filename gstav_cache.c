@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Author: agent <agent@local>
+ *
+ * This file may be used under the terms of the GNU Lesser General Public
+ * License version 2.1, a copy of which is found in LICENSE included in the
+ * packaging of this file.
+ */
+
+/*
+ * LRU cache of decoded frames, bounded by memory.
+ *
+ * Frames are stored as private copies, so buffers from a downstream pool are
+ * not held, and handed out as sub-buffers, so each push gets its own object.
+ */
+
+#include "gstav_cache.h"
+
+struct entry {
+	GstClockTime timestamp;
+	GstBuffer *buf;
+	GList link;
+};
+
+struct gst_av_cache {
+	GHashTable *table;
+	GQueue lru; /* least recently used first */
+	guint64 used, limit;
+	GMutex mutex;
+};
+
+static guint entry_hash(const void *key)
+{
+	const struct entry *e = key;
+	return (guint)(e->timestamp ^ (e->timestamp >> 32));
+}
+
+static gboolean entry_equal(const void *a, const void *b)
+{
+	const struct entry *ea = a, *eb = b;
+	return ea->timestamp == eb->timestamp;
+}
+
+static void remove_entry(struct gst_av_cache *cache, struct entry *e)
+{
+	g_hash_table_remove(cache->table, e);
+	g_queue_unlink(&cache->lru, &e->link);
+	cache->used -= e->buf->size;
+	gst_buffer_unref(e->buf);
+	g_slice_free(struct entry, e);
+}
+
+static void evict(struct gst_av_cache *cache, guint64 limit)
+{
+	while (cache->used > limit) {
+		struct entry *e = g_queue_peek_head(&cache->lru);
+		remove_entry(cache, e);
+	}
+}
+
+struct gst_av_cache *gst_av_cache_new(void)
+{
+	struct gst_av_cache *cache;
+
+	cache = g_slice_new0(struct gst_av_cache);
+	cache->table = g_hash_table_new(entry_hash, entry_equal);
+	g_queue_init(&cache->lru);
+	g_mutex_init(&cache->mutex);
+
+	return cache;
+}
+
+void gst_av_cache_free(struct gst_av_cache *cache)
+{
+	gst_av_cache_clear(cache);
+	g_hash_table_destroy(cache->table);
+	g_mutex_clear(&cache->mutex);
+	g_slice_free(struct gst_av_cache, cache);
+}
+
+void gst_av_cache_set_limit(struct gst_av_cache *cache, guint64 limit)
+{
+	g_mutex_lock(&cache->mutex);
+	cache->limit = limit;
+	evict(cache, limit);
+	g_mutex_unlock(&cache->mutex);
+}
+
+void gst_av_cache_clear(struct gst_av_cache *cache)
+{
+	g_mutex_lock(&cache->mutex);
+	evict(cache, 0);
+	g_mutex_unlock(&cache->mutex);
+}
+
+void gst_av_cache_insert(struct gst_av_cache *cache, GstBuffer *buf)
+{
+	struct entry key = { .timestamp = buf->timestamp };
+	struct entry *e;
+
+	g_mutex_lock(&cache->mutex);
+
+	if (buf->size > cache->limit)
+		goto leave;
+
+	e = g_hash_table_lookup(cache->table, &key);
+	if (e)
+		remove_entry(cache, e);
+
+	evict(cache, cache->limit - buf->size);
+
+	e = g_slice_new0(struct entry);
+	e->timestamp = buf->timestamp;
+	e->buf = gst_buffer_copy(buf);
+	e->link.data = e;
+
+	g_hash_table_insert(cache->table, e, e);
+	g_queue_push_tail_link(&cache->lru, &e->link);
+	cache->used += buf->size;
+
+leave:
+	g_mutex_unlock(&cache->mutex);
+}
+
+GstBuffer *gst_av_cache_lookup(struct gst_av_cache *cache, GstClockTime ts)
+{
+	struct entry key = { .timestamp = ts };
+	struct entry *e;
+	GstBuffer *buf = NULL;
+
+	g_mutex_lock(&cache->mutex);
+
+	e = g_hash_table_lookup(cache->table, &key);
+	if (!e)
+		goto leave;
+
+	/* most recently used */
+	g_queue_unlink(&cache->lru, &e->link);
+	g_queue_push_tail_link(&cache->lru, &e->link);
+
+	buf = gst_buffer_create_sub(e->buf, 0, e->buf->size);
+	gst_buffer_copy_metadata(buf, e->buf, GST_BUFFER_COPY_ALL);
+
+leave:
+	g_mutex_unlock(&cache->mutex);
+
+	return buf;
+}
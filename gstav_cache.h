@@ -0,0 +1,25 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Author: agent <agent@local>
+ *
+ * This file may be used under the terms of the GNU Lesser General Public
+ * License version 2.1, a copy of which is found in LICENSE included in the
+ * packaging of this file.
+ */
+
+#ifndef GST_AV_CACHE_H
+#define GST_AV_CACHE_H
+
+#include <gst/gst.h>
+
+struct gst_av_cache;
+
+struct gst_av_cache *gst_av_cache_new(void);
+void gst_av_cache_free(struct gst_av_cache *cache);
+void gst_av_cache_set_limit(struct gst_av_cache *cache, guint64 limit);
+void gst_av_cache_clear(struct gst_av_cache *cache);
+void gst_av_cache_insert(struct gst_av_cache *cache, GstBuffer *buf);
+GstBuffer *gst_av_cache_lookup(struct gst_av_cache *cache, GstClockTime ts);
+
+#endif /* GST_AV_CACHE_H */
@@ -409,6 +409,230 @@ failed:
 	return false;
 }
 
+/* find a 0x000001xx startcode, returns the offset of the code byte */
+static int find_startcode(const uint8_t *data, unsigned size, unsigned start, unsigned code)
+{
+	uint32_t bits = 0xffffffff;
+
+	for (unsigned i = start; i < size; i++) {
+		bits = (bits << 8) | data[i];
+		if (bits == (0x100 | code))
+			return i;
+	}
+
+	return -1;
+}
+
+bool gst_av_mpeg2_parse(struct gst_av_vdec *vdec, GstBuffer *buf)
+{
+	struct get_bit_context s;
+	int width, height;
+	int i;
+
+	/* sequence header */
+	i = find_startcode(buf->data, buf->size, 0, 0xB3);
+	if (i < 0)
+		goto failed;
+
+	init_get_bits(&s, buf->data + i + 1, (buf->size - i - 1) * 8);
+
+	if (get_bits_left(&s) < 40)
+		goto failed;
+
+	width = get_bits(&s, 12);
+	height = get_bits(&s, 12);
+	if (!width || !height)
+		goto failed;
+
+	/* sequence extension, only in MPEG-2 */
+	while ((i = find_startcode(buf->data, buf->size, i + 1, 0xB5)) >= 0) {
+		init_get_bits(&s, buf->data + i + 1, (buf->size - i - 1) * 8);
+
+		if (get_bits_left(&s) < 48)
+			break;
+
+		/* extension start code identifier */
+		if (get_bits(&s, 4) != 1)
+			continue;
+
+		/* profile and level, progressive sequence, chroma format */
+		skip_bits(&s, 11);
+
+		width |= get_bits(&s, 2) << 12;
+		height |= get_bits(&s, 2) << 12;
+		break;
+	}
+
+	set_framesize(vdec, width, height, 0, 0, 0, 0);
+	return true;
+
+failed:
+	return false;
+}
+
+bool gst_av_vc1_parse(struct gst_av_vdec *vdec, GstBuffer *buf)
+{
+	struct get_bit_context s;
+	int width, height;
+	int i;
+
+	/*
+	 * Only the advanced profile has a sequence header, for simple and main
+	 * profiles (WMV3) the size comes from the container.
+	 */
+	i = find_startcode(buf->data, buf->size, 0, 0x0F);
+	if (i < 0)
+		goto failed;
+
+	init_get_bits(&s, buf->data + i + 1, (buf->size - i - 1) * 8);
+
+	if (get_bits_left(&s) < 56)
+		goto failed;
+
+	/* advanced profile */
+	if (get_bits(&s, 2) != 3)
+		goto failed;
+
+	/* level, colordiff format, frmrtq and bitrtq postproc, postprocflag */
+	skip_bits(&s, 14);
+
+	width = (get_bits(&s, 12) + 1) * 2;
+	height = (get_bits(&s, 12) + 1) * 2;
+
+	set_framesize(vdec, width, height, 0, 0, 0, 0);
+	return true;
+
+failed:
+	return false;
+}
+
+bool gst_av_vp8_parse(struct gst_av_vdec *vdec, GstBuffer *buf)
+{
+	const uint8_t *p = buf->data;
+	int width, height;
+
+	if (buf->size < 10)
+		goto failed;
+
+	/* only key frames carry the size */
+	if (p[0] & 1)
+		goto failed;
+
+	/* key frame startcode */
+	if (p[3] != 0x9d || p[4] != 0x01 || p[5] != 0x2a)
+		goto failed;
+
+	/* ignore the upscaling bits */
+	width = (p[6] | p[7] << 8) & 0x3fff;
+	height = (p[8] | p[9] << 8) & 0x3fff;
+	if (!width || !height)
+		goto failed;
+
+	set_framesize(vdec, width, height, 0, 0, 0, 0);
+	return true;
+
+failed:
+	return false;
+}
+
+bool gst_av_theora_parse(struct gst_av_vdec *vdec, GstBuffer *buf)
+{
+	struct get_bit_context s;
+	int width, height;
+	int crop_width, crop_height;
+	int par_num, par_den;
+
+	if (buf->size < 42)
+		goto failed;
+
+	/* identification header */
+	if (buf->data[0] != 0x80 || memcmp(buf->data + 1, "theora", 6) != 0)
+		goto failed;
+
+	init_get_bits(&s, buf->data + 7, (buf->size - 7) * 8);
+
+	/* major version */
+	if (get_bits(&s, 8) != 3)
+		goto failed;
+
+	/* minor and revision versions */
+	skip_bits(&s, 16);
+
+	width = get_bits(&s, 16) * 16;
+	height = get_bits(&s, 16) * 16;
+	crop_width = get_bits(&s, 24);
+	crop_height = get_bits(&s, 24);
+	if (crop_width > width || crop_height > height)
+		goto failed;
+
+	/* picture offsets and framerate */
+	skip_bits(&s, 16);
+	skip_bits(&s, 32);
+	skip_bits(&s, 32);
+
+	par_num = get_bits(&s, 24);
+	par_den = get_bits(&s, 24);
+
+	set_framesize(vdec, width, height, par_num, par_den, crop_width, crop_height);
+	return true;
+
+failed:
+	return false;
+}
+
+bool gst_av_jpeg_parse(struct gst_av_vdec *vdec, GstBuffer *buf)
+{
+	const uint8_t *p = buf->data;
+	unsigned i = 2;
+	int width, height;
+
+	/* start of image */
+	if (buf->size < 4 || p[0] != 0xff || p[1] != 0xd8)
+		goto failed;
+
+	while (i + 4 <= buf->size) {
+		unsigned marker, len;
+
+		if (p[i] != 0xff)
+			goto failed;
+		marker = p[i + 1];
+		if (marker == 0xff) {
+			/* fill byte */
+			i++;
+			continue;
+		}
+		len = AV_RB16(p + i + 2);
+
+		switch (marker) {
+		case 0xc4: /* DHT */
+		case 0xc8: /* JPG */
+		case 0xcc: /* DAC */
+			break;
+		case 0xda: /* SOS */
+			goto failed;
+		default:
+			if (marker < 0xc0 || marker > 0xcf)
+				break;
+
+			/* start of frame */
+			if (i + 9 > buf->size)
+				goto failed;
+			height = AV_RB16(p + i + 5);
+			width = AV_RB16(p + i + 7);
+			if (!width || !height)
+				goto failed;
+
+			set_framesize(vdec, width, height, 0, 0, 0, 0);
+			return true;
+		}
+
+		i += 2 + len;
+	}
+
+failed:
+	return false;
+}
+
 static unsigned read_bits(struct get_bit_context *s, int n)
 {
 	n = MIN(n, get_bits_left(s));
@@ -528,6 +752,7 @@ try_again:
 		d = get_bits(&s, 8);
 		if ((d & 0xfc) != 0xfc)
 			return FALSE;
+		vdec->nal_length_size = (d & 0x3) + 1;
 		d = get_bits(&s, 8);
 
 		/* number of SPS */
@@ -731,3 +956,337 @@ bail:
 	free(rbsp_buffer);
 	return false;
 }
+
+static bool next_nal(struct gst_av_vdec *vdec, GstBuffer *buf, unsigned *offset,
+		uint8_t **nal, unsigned *nal_size)
+{
+	const uint8_t *data = buf->data;
+	unsigned i = *offset;
+
+	if (vdec->nal_length_size) {
+		unsigned len = 0;
+
+		if (i + vdec->nal_length_size > buf->size)
+			return false;
+		for (int j = 0; j < vdec->nal_length_size; j++)
+			len = (len << 8) | data[i++];
+		if (!len || i + len > buf->size)
+			return false;
+
+		*nal = buf->data + i;
+		*nal_size = len;
+		*offset = i + len;
+		return true;
+	}
+
+	/* byte-stream */
+	for (; i + 3 < buf->size; i++) {
+		if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1)
+			break;
+	}
+	if (i + 3 >= buf->size)
+		return false;
+	i += 3;
+
+	*nal = buf->data + i;
+	for (; i + 2 < buf->size; i++) {
+		if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] <= 1)
+			break;
+	}
+	if (i + 2 >= buf->size)
+		i = buf->size;
+	*nal_size = buf->data + i - *nal;
+	*offset = i;
+	return true;
+}
+
+/* look for a recovery point SEI message */
+static bool h264_recovery_point(uint8_t *nal, unsigned nal_size, int *recovery_frames)
+{
+	struct get_bit_context s;
+	uint8_t *rbsp_buffer = NULL;
+	unsigned rbsp_len;
+	bool found = false;
+
+	/* skip NAL header */
+	nal++;
+	nal_size--;
+
+	if (rbsp_unescape(nal, nal_size, &rbsp_buffer, &rbsp_len)) {
+		nal = rbsp_buffer;
+		nal_size = rbsp_len;
+	}
+
+	init_get_bits(&s, nal, nal_size * 8);
+
+	/* rbsp trailing bits */
+	while (get_bits_left(&s) > 16) {
+		unsigned type = 0, size = 0, b;
+
+		do {
+			b = get_bits(&s, 8);
+			type += b;
+		} while (b == 0xff && get_bits_left(&s) >= 8);
+
+		if (get_bits_left(&s) < 8)
+			break;
+
+		do {
+			b = get_bits(&s, 8);
+			size += b;
+		} while (b == 0xff && get_bits_left(&s) >= 8);
+
+		if (type == 6) {
+			/* recovery_frame_cnt */
+			*recovery_frames = get_ue_golomb(&s);
+			found = true;
+			break;
+		}
+
+		if ((int)size * 8 > get_bits_left(&s))
+			break;
+		skip_bits(&s, size * 8);
+	}
+
+	free(rbsp_buffer);
+	return found;
+}
+
+/*
+ * Check if decoding can start from this buffer; an IDR picture, or a
+ * recovery point SEI, after which the output is correct after
+ * 'recovery_frames' frames.
+ */
+bool gst_av_h264_sync_point(struct gst_av_vdec *vdec, GstBuffer *buf,
+		bool *idr, int *recovery_frames)
+{
+	unsigned offset = 0;
+	uint8_t *nal;
+	unsigned nal_size;
+	bool found = false;
+
+	*idr = false;
+	*recovery_frames = 0;
+
+	while (next_nal(vdec, buf, &offset, &nal, &nal_size)) {
+		if (!nal_size)
+			continue;
+
+		switch (nal[0] & 0x1f) {
+		case 5:
+			*idr = true;
+			*recovery_frames = 0;
+			return true;
+		case 6:
+			if (!found)
+				found = h264_recovery_point(nal, nal_size, recovery_frames);
+			break;
+		default:
+			break;
+		}
+	}
+
+	return found;
+}
+
+bool gst_av_h265_parse(struct gst_av_vdec *vdec, GstBuffer *buf)
+{
+	struct get_bit_context s;
+	const uint8_t *data = buf->data;
+	uint8_t *nal = NULL;
+	unsigned nal_size = 0;
+	unsigned max_sub_layers, chroma;
+	unsigned profile_present = 0, level_present = 0;
+	unsigned fc_left, fc_right, fc_top, fc_bottom;
+	gint width, height;
+	gint crop_width, crop_height;
+	guint subwc[] = { 1, 2, 2, 1 }, subhc[] = { 1, 2, 1, 1 };
+	uint8_t *rbsp_buffer = NULL;
+	unsigned rbsp_len;
+
+	if (buf->size < 4)
+		goto not_enough_data;
+
+	if (data[0] == 1) {
+		/* hvcC codec_data */
+		unsigned offset = 23;
+
+		if (buf->size < 23)
+			goto not_enough_data;
+
+		for (unsigned i = 0; i < data[22] && !nal; i++) {
+			unsigned type, count;
+
+			if (offset + 3 > buf->size)
+				goto not_enough_data;
+			type = data[offset] & 0x3f;
+			count = AV_RB16(data + offset + 1);
+			offset += 3;
+
+			for (unsigned j = 0; j < count; j++) {
+				unsigned len;
+
+				if (offset + 2 > buf->size)
+					goto not_enough_data;
+				len = AV_RB16(data + offset);
+				offset += 2;
+				if (offset + len > buf->size)
+					goto not_enough_data;
+				if (type == 33) {
+					nal = buf->data + offset;
+					nal_size = len;
+					break;
+				}
+				offset += len;
+			}
+		}
+	} else {
+		/* locate SPS NAL unit in bytestream */
+		for (unsigned i = 0; i + 4 < buf->size; i++) {
+			if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1 &&
+					((data[i + 3] >> 1) & 0x3f) == 33)
+			{
+				nal = buf->data + i + 3;
+				nal_size = buf->size - i - 3;
+				break;
+			}
+		}
+	}
+
+	if (!nal)
+		goto bail;
+
+	if (rbsp_unescape(nal, nal_size, &rbsp_buffer, &rbsp_len))
+		init_get_bits(&s, rbsp_buffer, rbsp_len << 3);
+	else
+		init_get_bits(&s, nal, nal_size << 3);
+
+	/* NAL header and profile_tier_level() general part */
+	if (get_bits_left(&s) < 16 + 8 + 96 + 16)
+		goto not_enough_data;
+
+	/* forbidden bit */
+	if (get_bits1(&s))
+		goto bail;
+
+	/* need SPS NAL unit */
+	if (get_bits(&s, 6) != 33)
+		goto bail;
+
+	/* layer id, temporal id */
+	skip_bits(&s, 9);
+
+	/* sps_video_parameter_set_id */
+	skip_bits(&s, 4);
+	max_sub_layers = get_bits(&s, 3);
+	/* sps_temporal_id_nesting_flag */
+	skip_bits(&s, 1);
+
+	/* general profile, tier and level */
+	skip_bits(&s, 96);
+
+	for (unsigned i = 0; i < max_sub_layers; i++) {
+		profile_present |= get_bits1(&s) << i;
+		level_present |= get_bits1(&s) << i;
+	}
+	if (max_sub_layers > 0)
+		/* reserved_zero_2bits */
+		skip_bits(&s, (8 - max_sub_layers) * 2);
+
+	for (unsigned i = 0; i < max_sub_layers; i++) {
+		if (profile_present & (1 << i))
+			skip_bits(&s, 88);
+		if (level_present & (1 << i))
+			skip_bits(&s, 8);
+	}
+	CHECK_EOS(&s);
+
+	/* sps_seq_parameter_set_id */
+	get_ue_golomb(&s);
+	CHECK_EOS(&s);
+	chroma = get_ue_golomb(&s);
+	CHECK_EOS(&s);
+	if (chroma > 3)
+		goto bail;
+	if (chroma == 3) {
+		/* separate_colour_plane_flag */
+		if (read_bits(&s, 1))
+			chroma = 0;
+		CHECK_EOS(&s);
+	}
+	/* pic_width_in_luma_samples */
+	width = get_ue_golomb(&s);
+	CHECK_EOS(&s);
+	/* pic_height_in_luma_samples */
+	height = get_ue_golomb(&s);
+	CHECK_EOS(&s);
+	/* conformance_window_flag */
+	if (read_bits(&s, 1)) {
+		fc_left = get_ue_golomb(&s);
+		CHECK_EOS(&s);
+		fc_right = get_ue_golomb(&s);
+		CHECK_EOS(&s);
+		fc_top = get_ue_golomb(&s);
+		CHECK_EOS(&s);
+		fc_bottom = get_ue_golomb(&s);
+		CHECK_EOS(&s);
+	} else
+		fc_left = fc_right = fc_top = fc_bottom = 0;
+
+	crop_width = width - (fc_left + fc_right) * subwc[chroma];
+	crop_height = height - (fc_top + fc_bottom) * subhc[chroma];
+	if (width <= 0 || height <= 0 || crop_width <= 0 || crop_height <= 0)
+		goto bail;
+
+	set_framesize(vdec, width, height, 0, 0, crop_width, crop_height);
+	free(rbsp_buffer);
+	return true;
+
+not_enough_data:
+bail:
+	free(rbsp_buffer);
+	return false;
+}
+
+/*
+ * Whether the buffer starts a new access unit: a delimiter, parameter set
+ * or SEI after the slices of the previous picture, or the first slice of
+ * a new picture (first_mb_in_slice == 0).
+ */
+bool gst_av_h264_au_start(struct gst_av_vdec *vdec, GstBuffer *buf)
+{
+	unsigned offset = 0;
+	uint8_t *nal;
+	unsigned nal_size;
+	bool start = false;
+
+	while (next_nal(vdec, buf, &offset, &nal, &nal_size)) {
+		int type = nal[0] & 0x1f;
+
+		if (type == 1 || type == 5) {
+			if (nal_size > 1 && (nal[1] & 0x80) && vdec->vcl_seen)
+				start = true;
+			vdec->vcl_seen = true;
+		} else if ((type >= 6 && type <= 9) || (type >= 14 && type <= 18)) {
+			if (vdec->vcl_seen)
+				start = true;
+			vdec->vcl_seen = false;
+		}
+	}
+
+	return start;
+}
+
+/* the type of the first NAL, for NAL aligned buffers */
+int gst_av_h264_nal_type(struct gst_av_vdec *vdec, GstBuffer *buf)
+{
+	unsigned offset = 0;
+	uint8_t *nal;
+	unsigned nal_size;
+
+	while (next_nal(vdec, buf, &offset, &nal, &nal_size))
+		if (nal_size)
+			return nal[0] & 0x1f;
+
+	return -1;
+}
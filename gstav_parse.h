@@ -21,5 +21,15 @@ struct gst_av_vdec;
 bool gst_av_h263_parse(struct gst_av_vdec *vdec, GstBuffer *buf);
 bool gst_av_mpeg4_parse(struct gst_av_vdec *vdec, GstBuffer *buf);
 bool gst_av_h264_parse(struct gst_av_vdec *vdec, GstBuffer *buf);
+bool gst_av_mpeg2_parse(struct gst_av_vdec *vdec, GstBuffer *buf);
+bool gst_av_vc1_parse(struct gst_av_vdec *vdec, GstBuffer *buf);
+bool gst_av_vp8_parse(struct gst_av_vdec *vdec, GstBuffer *buf);
+bool gst_av_theora_parse(struct gst_av_vdec *vdec, GstBuffer *buf);
+bool gst_av_h265_parse(struct gst_av_vdec *vdec, GstBuffer *buf);
+bool gst_av_jpeg_parse(struct gst_av_vdec *vdec, GstBuffer *buf);
+bool gst_av_h264_sync_point(struct gst_av_vdec *vdec, GstBuffer *buf,
+		bool *idr, int *recovery_frames);
+bool gst_av_h264_au_start(struct gst_av_vdec *vdec, GstBuffer *buf);
+int gst_av_h264_nal_type(struct gst_av_vdec *vdec, GstBuffer *buf);
 
 #endif
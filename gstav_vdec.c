@@ -14,6 +14,8 @@
 #include <libavcodec/avcodec.h>
 #include <libavutil/imgutils.h>
 #include <libavutil/mem.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
 #include <gst/tag/tag.h>
 
 #include <stdlib.h>
@@ -35,25 +37,281 @@ struct obj_class {
 
 #define ROUND_UP(num, scale) (((num) + ((scale) - 1)) & ~((scale) - 1))
 
+#if LIBAVCODEC_VERSION_MAJOR > 55 || (LIBAVCODEC_VERSION_MAJOR == 55 && LIBAVCODEC_VERSION_MINOR >= 24)
+#define HAVE_HEVC
+#endif
+
+#ifndef AV_NUM_DATA_POINTERS
+#define AV_NUM_DATA_POINTERS 4
+#endif
+
+#if LIBAVUTIL_VERSION_INT < AV_VERSION_INT(52, 3, 0)
+#define av_pix_fmt_desc_get(pix_fmt) (&av_pix_fmt_descriptors[pix_fmt])
+#endif
+
+enum {
+	PROP_0,
+	PROP_MAX_THREADS,
+	PROP_CACHE_SIZE,
+	PROP_CACHE_HIT_RATE,
+	PROP_SEEK_LATENCY,
+	PROP_ERROR_RECOVERY,
+	PROP_FRAMES_DISCARDED,
+	PROP_FAST_START,
+	PROP_JOIN_TIME,
+	PROP_JOIN_DISCARDED,
+	PROP_POOL_SIZE,
+	PROP_REVERSE_MEMORY,
+	PROP_LOW_DELAY,
+	PROP_FRAME_LATENCY,
+	PROP_BAND_EVENTS,
+	PROP_VERIFY,
+	PROP_VERIFY_LOCATION,
+	PROP_OUTPUT_WIDTH,
+	PROP_OUTPUT_HEIGHT,
+};
+
+enum {
+	RECOVERY_NONE,
+	RECOVERY_KEY_FRAME,
+	RECOVERY_POINT,
+};
+
+#define GST_AV_VDEC_RECOVERY_TYPE (gst_av_vdec_recovery_get_type())
+
+static GType
+gst_av_vdec_recovery_get_type(void)
+{
+	static GType type;
+
+	if (G_UNLIKELY(type == 0)) {
+		static const GEnumValue values[] = {
+			{ RECOVERY_NONE, "Keep decoding", "none" },
+			{ RECOVERY_KEY_FRAME, "Skip to the next key frame", "key-frame" },
+			{ RECOVERY_POINT, "Skip to the next key frame or recovery point", "recovery-point" },
+			{ 0, NULL, NULL },
+		};
+
+		type = g_enum_register_static("GstAVVideoDecRecovery", values);
+	}
+
+	return type;
+}
+
+enum {
+	FAST_START_NONE,
+	FAST_START_RECOVERY,
+	FAST_START_PARTIAL,
+};
+
+#define GST_AV_VDEC_FAST_START_TYPE (gst_av_vdec_fast_start_get_type())
+
+static GType
+gst_av_vdec_fast_start_get_type(void)
+{
+	static GType type;
+
+	if (G_UNLIKELY(type == 0)) {
+		static const GEnumValue values[] = {
+			{ FAST_START_NONE, "Decode from the first buffer", "none" },
+			{ FAST_START_RECOVERY, "Start from the first key frame or recovery point", "recovery-point" },
+			{ FAST_START_PARTIAL, "Also show partially refreshed frames", "partial" },
+			{ 0, NULL, NULL },
+		};
+
+		type = g_enum_register_static("GstAVVideoDecFastStart", values);
+	}
+
+	return type;
+}
+
+struct format {
+	enum PixelFormat pix_fmt;
+	guint32 fourcc;
+	int hshift, vshift;
+};
+
+static const struct format formats[] = {
+	{ PIX_FMT_YUV420P, GST_MAKE_FOURCC('I', '4', '2', '0'), 1, 1 },
+	{ PIX_FMT_YUVJ420P, GST_MAKE_FOURCC('I', '4', '2', '0'), 1, 1 },
+	{ PIX_FMT_YUV422P, GST_MAKE_FOURCC('Y', '4', '2', 'B'), 1, 0 },
+	{ PIX_FMT_YUVJ422P, GST_MAKE_FOURCC('Y', '4', '2', 'B'), 1, 0 },
+	{ PIX_FMT_YUV444P, GST_MAKE_FOURCC('Y', '4', '4', '4'), 0, 0 },
+	{ PIX_FMT_YUVJ444P, GST_MAKE_FOURCC('Y', '4', '4', '4'), 0, 0 },
+};
+
 static void get_delayed(struct obj *self);
 
+static const struct format *find_format(enum PixelFormat pix_fmt)
+{
+	for (unsigned i = 0; i < ARRAY_SIZE(formats); i++)
+		if (formats[i].pix_fmt == pix_fmt)
+			return &formats[i];
+	return NULL;
+}
+
+/* the output format; anything else is converted to I420 */
+static const struct format *get_format(enum PixelFormat pix_fmt)
+{
+	const struct format *fmt = find_format(pix_fmt);
+
+	return fmt ? fmt : &formats[0];
+}
+
+/* plane strides and offsets, as GStreamer lays out raw video */
+static size_t plane_layout(guint32 fourcc, int width, int height,
+		int *stride, size_t *offset, int *rows)
+{
+	int chroma_height;
+
+	stride[0] = GST_ROUND_UP_4(width);
+
+	switch (fourcc) {
+	case GST_MAKE_FOURCC('Y', '4', '2', 'B'):
+		stride[1] = stride[2] = GST_ROUND_UP_8(width) / 2;
+		chroma_height = height;
+		break;
+	case GST_MAKE_FOURCC('Y', '4', '4', '4'):
+		stride[1] = stride[2] = stride[0];
+		chroma_height = height;
+		break;
+	default:
+		stride[1] = stride[2] = GST_ROUND_UP_4(GST_ROUND_UP_2(width) / 2);
+		height = GST_ROUND_UP_2(height);
+		chroma_height = height / 2;
+		break;
+	}
+
+	offset[0] = 0;
+	offset[1] = stride[0] * height;
+	offset[2] = offset[1] + stride[1] * chroma_height;
+
+	if (rows) {
+		rows[0] = height;
+		rows[1] = rows[2] = chroma_height;
+	}
+
+	return offset[2] + stride[2] * chroma_height;
+}
+
+/* a missing dimension keeps the aspect ratio */
+static void output_size(struct obj *self, int *width, int *height)
+{
+	AVCodecContext *ctx = self->av_ctx;
+
+	*width = self->out_width ? ROUND_UP(self->out_width, 2) : ctx->width;
+	*height = self->out_height ? ROUND_UP(self->out_height, 2) : ctx->height;
+
+	if (!ctx->width || !ctx->height)
+		return;
+
+	if (self->out_width && !self->out_height)
+		*height = ROUND_UP(ctx->height * *width / ctx->width, 2);
+	else if (self->out_height && !self->out_width)
+		*width = ROUND_UP(ctx->width * *height / ctx->height, 2);
+}
+
+static inline bool scaling(struct obj *self)
+{
+	return self->out_width || self->out_height;
+}
+
+/* e.g. 10-bit, which raw video in 0.10 can't carry */
+static inline bool converting(struct obj *self)
+{
+	return scaling(self) || !find_format(self->av_ctx->pix_fmt);
+}
+
+static void set_src_caps(struct obj *self)
+{
+	AVCodecContext *ctx = self->av_ctx;
+	const struct format *fmt = get_format(ctx->pix_fmt);
+	GstCaps *new_caps;
+	GstStructure *struc;
+	int width, height;
+	AVRational par = ctx->sample_aspect_ratio;
+
+	output_size(self, &width, &height);
+
+	/* keep the display aspect ratio */
+	if (scaling(self) && ctx->width && ctx->height) {
+		if (!par.num)
+			par = (AVRational){ 1, 1 };
+		gst_util_fraction_multiply(par.num, par.den,
+				ctx->width * height, ctx->height * width,
+				&par.num, &par.den);
+	}
+
+	new_caps = gst_caps_new_empty();
+
+	struc = gst_structure_new("video/x-raw-yuv",
+			"width", G_TYPE_INT, width,
+			"height", G_TYPE_INT, height,
+			"format", GST_TYPE_FOURCC, fmt->fourcc,
+			NULL);
+
+	if (ctx->time_base.num)
+		gst_structure_set(struc,
+				"framerate", GST_TYPE_FRACTION,
+				ctx->time_base.den,
+				ctx->time_base.num * ctx->ticks_per_frame,
+				NULL);
+
+	if (par.num)
+		gst_structure_set(struc,
+				"pixel-aspect-ratio", GST_TYPE_FRACTION,
+				par.num, par.den,
+				NULL);
+
+	gst_caps_append_structure(new_caps, struc);
+
+	if (ctx->pix_fmt != PIX_FMT_NONE && !find_format(ctx->pix_fmt))
+		GST_INFO_OBJECT(self, "converting pixel format %d", ctx->pix_fmt);
+
+	GST_INFO_OBJECT(self, "caps are: %" GST_PTR_FORMAT, new_caps);
+	gst_pad_set_caps(self->srcpad, new_caps);
+	gst_caps_unref(new_caps);
+
+	self->fourcc = fmt->fourcc;
+	self->width = ctx->width;
+	self->height = ctx->height;
+}
+
+/* the pixel format, or the size, might only be known after decoding */
+static inline void check_src_caps(struct obj *self)
+{
+	AVCodecContext *ctx = self->av_ctx;
+
+	if (G_UNLIKELY(get_format(ctx->pix_fmt)->fourcc != self->fourcc ||
+				ctx->width != self->width || ctx->height != self->height))
+		set_src_caps(self);
+}
+
 static int get_buffer(AVCodecContext *avctx, AVFrame *pic)
 {
 	GstBuffer *out_buf;
 	GstFlowReturn ret;
 	struct obj *self = avctx->opaque;
+	const struct format *fmt;
 	int width = avctx->width;
 	int height = avctx->height;
+	int chroma_width, chroma_height;
 
 	avcodec_align_dimensions(avctx, &width, &height);
 
+	check_src_caps(self);
+	fmt = get_format(avctx->pix_fmt);
+	chroma_width = width >> fmt->hshift;
+	chroma_height = height >> fmt->vshift;
+
 	pic->linesize[0] = width;
-	pic->linesize[1] = width / 2;
-	pic->linesize[2] = width / 2;
+	pic->linesize[1] = chroma_width;
+	pic->linesize[2] = chroma_width;
 
-	if (avctx->width == width && avctx->height == height) {
+	/* frames that are not pushed right away */
+	if (!self->preroll && !self->verify && !converting(self) && avctx->width == width && avctx->height == height) {
 		ret = gst_pad_alloc_buffer_and_set_caps(self->srcpad, 0,
-				width * height * 3 / 2,
+				width * height + chroma_width * chroma_height * 2,
 				self->srcpad->caps, &out_buf);
 		if (ret != GST_FLOW_OK)
 			return 1;
@@ -62,7 +320,7 @@ static int get_buffer(AVCodecContext *avctx, AVFrame *pic)
 
 		pic->data[0] = out_buf->data;
 		pic->data[1] = pic->data[0] + pic->linesize[0] * height;
-		pic->data[2] = pic->data[1] + pic->linesize[1] * height / 2;
+		pic->data[2] = pic->data[1] + pic->linesize[1] * chroma_height;
 	} else {
 		ret = av_image_alloc(pic->base, pic->linesize, width, height, avctx->pix_fmt, 1);
 		if (ret < 0)
@@ -106,36 +364,37 @@ static int reget_buffer(AVCodecContext *avctx, AVFrame *pic)
 	return 0;
 }
 
-static GstBuffer *convert_frame(struct obj *self, AVFrame *frame)
+/*
+ * Tell downstream which rows of the output buffer are already decoded, so
+ * it can start working on them. The event carries the buffer that will be
+ * pushed later.
+ */
+static void draw_band(AVCodecContext *avctx, const AVFrame *src,
+		int offset[AV_NUM_DATA_POINTERS], int y, int type, int height)
 {
-	GstBuffer *out_buf;
-	int64_t v;
-
-	out_buf = frame->opaque;
+	struct obj *self = avctx->opaque;
+	GstBuffer *buf = src->opaque;
+	GstStructure *struc;
 
-	if (!out_buf) {
-		AVCodecContext *ctx;
-		int i;
-		guint8 *p;
-		int width, height;
+	/* not directly rendered */
+	if (!buf)
+		return;
 
-		ctx = self->av_ctx;
-		width = ROUND_UP(ctx->width, 4);
-		height = ctx->height;
+	struc = gst_structure_new("GstAVVideoBand",
+			"buffer", GST_TYPE_BUFFER, buf,
+			"timestamp", G_TYPE_UINT64,
+			gstav_pts_to_timestamp(avctx, src->pkt_pts),
+			"y", G_TYPE_INT, y,
+			"height", G_TYPE_INT, height,
+			NULL);
 
-		out_buf = gst_buffer_new_and_alloc(width * height * 3 / 2);
-		gst_buffer_set_caps(out_buf, self->srcpad->caps);
+	gst_pad_push_event(self->srcpad,
+			gst_event_new_custom(GST_EVENT_CUSTOM_DOWNSTREAM_OOB, struc));
+}
 
-		p = out_buf->data;
-		for (i = 0; i < height; i++)
-			memcpy(p + i * width, frame->data[0] + i * frame->linesize[0], width);
-		p = out_buf->data + width * height;
-		for (i = 0; i < height / 2; i++)
-			memcpy(p + i * width / 2, frame->data[1] + i * frame->linesize[1], width / 2);
-		p = out_buf->data + width * height * 5 / 4;
-		for (i = 0; i < height / 2; i++)
-			memcpy(p + i * width / 2, frame->data[2] + i * frame->linesize[2], width / 2);
-	}
+static GstClockTime frame_timestamp(struct obj *self, AVFrame *frame)
+{
+	int64_t v;
 
 #if LIBAVCODEC_VERSION_MAJOR < 53
 	v = frame->reordered_opaque;
@@ -154,100 +413,854 @@ static GstBuffer *convert_frame(struct obj *self, AVFrame *frame)
 		v = frame->pkt_dts;
 #endif
 
-	out_buf->timestamp = gstav_pts_to_timestamp(self->av_ctx, v);
+	return gstav_pts_to_timestamp(self->av_ctx, v);
+}
+
+static GstClockTime frame_duration(struct obj *self)
+{
+	AVCodecContext *ctx = self->av_ctx;
+
+	if (!ctx->time_base.den)
+		return 0;
+
+	return gst_util_uint64_scale(GST_SECOND,
+			ctx->time_base.num * ctx->ticks_per_frame, ctx->time_base.den);
+}
+
+/* whether a frame would be clipped by the segment anyway */
+static bool before_segment(struct obj *self, GstClockTime timestamp)
+{
+	GstSegment *segment = &self->segment;
+
+	if (segment->format != GST_FORMAT_TIME || segment->rate < 0.0)
+		return false;
+
+	if (!GST_CLOCK_TIME_IS_VALID(timestamp))
+		return false;
+
+	return timestamp + frame_duration(self) <= (GstClockTime)segment->start;
+}
+
+/* scale straight from the decoded frame into the output buffer */
+static GstBuffer *scale_frame(struct obj *self, AVFrame *frame)
+{
+	AVCodecContext *ctx = self->av_ctx;
+	const struct format *fmt;
+	GstBuffer *out_buf;
+	int width, height;
+	uint8_t *data[4];
+	int linesize[4];
+	size_t offset[3];
+	size_t size;
+
+	check_src_caps(self);
+	fmt = get_format(ctx->pix_fmt);
+	output_size(self, &width, &height);
+
+	/* the format in the caps */
+	self->sws = sws_getCachedContext(self->sws,
+			ctx->width, ctx->height, ctx->pix_fmt,
+			width, height, fmt->pix_fmt,
+			SWS_BILINEAR, NULL, NULL, NULL);
+	if (!self->sws)
+		return NULL;
+
+	size = plane_layout(fmt->fourcc, width, height, linesize, offset, NULL);
+	linesize[3] = 0;
+
+	out_buf = gst_buffer_new_and_alloc(size);
+	gst_buffer_set_caps(out_buf, self->srcpad->caps);
+
+	for (int i = 0; i < 3; i++)
+		data[i] = out_buf->data + offset[i];
+	data[3] = NULL;
+
+	sws_scale(self->sws, (const uint8_t *const *)frame->data, frame->linesize,
+			0, ctx->height, data, linesize);
 
 	return out_buf;
 }
 
-static GstFlowReturn
-pad_chain(GstPad *pad, GstBuffer *buf)
+static GstBuffer *convert_frame(struct obj *self, AVFrame *frame)
+{
+	GstBuffer *out_buf;
+
+	if (converting(self))
+		return scale_frame(self, frame);
+
+	out_buf = frame->opaque;
+
+	if (!out_buf) {
+		AVCodecContext *ctx;
+		const struct format *fmt;
+		int stride[3], rows[3];
+		size_t offset[3];
+
+		ctx = self->av_ctx;
+		check_src_caps(self);
+		fmt = get_format(ctx->pix_fmt);
+
+		out_buf = gst_buffer_new_and_alloc(plane_layout(fmt->fourcc,
+					ctx->width, ctx->height, stride, offset, rows));
+		gst_buffer_set_caps(out_buf, self->srcpad->caps);
+
+		for (int c = 0; c < 3; c++) {
+			guint8 *p = out_buf->data + offset[c];
+			for (int i = 0; i < rows[c]; i++)
+				memcpy(p + i * stride[c], frame->data[c] + i * frame->linesize[c], stride[c]);
+		}
+	}
+
+	return out_buf;
+}
+
+static GstFlowReturn push(struct obj *self, GstBuffer *out_buf)
+{
+	if (G_UNLIKELY(self->join_start)) {
+		self->join_time = g_get_monotonic_time() - self->join_start;
+		self->join_start = 0;
+		GST_INFO_OBJECT(self, "first frame %" G_GINT64_FORMAT " us after start",
+				self->join_time);
+	}
+
+	if (self->chain_start) {
+		self->frame_latency = g_get_monotonic_time() - self->chain_start;
+		self->chain_start = 0;
+		GST_LOG_OBJECT(self, "frame latency %" G_GINT64_FORMAT " us",
+				self->frame_latency);
+	}
+
+	if (G_UNLIKELY(self->flush_time)) {
+		self->seek_latency = g_get_monotonic_time() - self->flush_time;
+		self->flush_time = 0;
+		GST_INFO_OBJECT(self, "first frame %" G_GINT64_FORMAT " us after flush",
+				self->seek_latency);
+	}
+
+	return gst_pad_push(self->srcpad, out_buf);
+}
+
+static GstBuffer *frame_to_buffer(struct obj *self, AVFrame *frame)
+{
+	GstBuffer *out_buf;
+	GstClockTime timestamp;
+
+	timestamp = frame_timestamp(self, frame);
+
+	if (before_segment(self, timestamp)) {
+		GST_LOG_OBJECT(self, "skipping frame before segment start");
+		return NULL;
+	}
+
+	/* not completely refreshed yet */
+	if (self->skip_frames) {
+		self->skip_frames--;
+		return NULL;
+	}
+
+	/* already pushed from the cache */
+	if (GST_CLOCK_TIME_IS_VALID(self->replay_last) &&
+			timestamp <= self->replay_last)
+		return NULL;
+
+	out_buf = convert_frame(self, frame);
+	if (!out_buf)
+		return NULL;
+	out_buf->timestamp = timestamp;
+
+	/* when frames are skipped, each one is shown until the next */
+	if (self->discard >= AVDISCARD_NONREF && GST_CLOCK_TIME_IS_VALID(timestamp)) {
+		GstClockTime duration = frame_duration(self);
+
+		if (GST_CLOCK_TIME_IS_VALID(self->last_out) && timestamp > self->last_out &&
+				timestamp - self->last_out > duration)
+			duration = timestamp - self->last_out;
+		out_buf->duration = duration;
+		self->last_out = timestamp;
+	}
+
+	if (self->cache_size && GST_CLOCK_TIME_IS_VALID(timestamp))
+		gst_av_cache_insert(self->cache, out_buf);
+
+	return out_buf;
+}
+
+/*
+ * Keep the frames of the current decoding pass that fall in the range to
+ * push next. In the first pass the range is unknown, so only the last
+ * ones that fit in memory are kept.
+ */
+static GstFlowReturn collect_frame(struct obj *self, AVFrame *frame)
+{
+	GstBuffer *out_buf;
+	int idx = self->rev_idx++;
+
+	if (idx < self->rev_lo || idx >= self->rev_hi)
+		return GST_FLOW_OK;
+
+	out_buf = frame_to_buffer(self, frame);
+	if (!out_buf)
+		return GST_FLOW_OK;
+
+	GST_BUFFER_OFFSET(out_buf) = idx;
+	g_queue_push_tail(&self->rev_frames, out_buf);
+	self->rev_bytes += out_buf->size;
+
+	if (self->rev_hi != G_MAXINT)
+		return GST_FLOW_OK;
+
+	while (self->rev_bytes > self->rev_max_bytes && self->rev_frames.length > 1) {
+		out_buf = g_queue_pop_head(&self->rev_frames);
+		self->rev_bytes -= out_buf->size;
+		gst_buffer_unref(out_buf);
+	}
+
+	return GST_FLOW_OK;
+}
+
+/* checksum the visible pixels instead of pushing them */
+static GstFlowReturn verify_frame(struct obj *self, AVFrame *frame)
+{
+	AVCodecContext *ctx = self->av_ctx;
+	const AVPixFmtDescriptor *desc;
+	GstClockTime timestamp;
+	uint32_t crc = 0;
+
+	timestamp = frame_timestamp(self, frame);
+	desc = av_pix_fmt_desc_get(ctx->pix_fmt);
+
+	/* as decoded, in bytes, including the last odd chroma column and row */
+	for (int p = 0; p < 3; p++) {
+		int width = av_image_get_linesize(ctx->pix_fmt, ctx->width, p);
+		int height = p ? -((-ctx->height) >> desc->log2_chroma_h) : ctx->height;
+
+		for (int i = 0; i < height; i++)
+			crc = gstav_crc32c(crc, frame->data[p] + i * frame->linesize[p], width);
+	}
+
+	if (self->verify_location) {
+		if (!self->verify_file) {
+			self->verify_file = fopen(self->verify_location, "w");
+			if (!self->verify_file) {
+				GST_ELEMENT_ERROR(self, RESOURCE, OPEN_WRITE, (NULL),
+						("couldn't open %s", self->verify_location));
+				return GST_FLOW_ERROR;
+			}
+		}
+		fprintf(self->verify_file, "%" G_GUINT64_FORMAT " %" GST_TIME_FORMAT " %08x\n",
+				self->verify_frames, GST_TIME_ARGS(timestamp), crc);
+	} else {
+		GstStructure *struc;
+
+		struc = gst_structure_new("GstAVVideoVerify",
+				"frame", G_TYPE_UINT64, self->verify_frames,
+				"timestamp", G_TYPE_UINT64, timestamp,
+				"crc32c", G_TYPE_UINT, crc,
+				NULL);
+		gst_element_post_message(GST_ELEMENT(self),
+				gst_message_new_element(GST_OBJECT(self), struc));
+	}
+
+	self->verify_frames++;
+
+	return GST_FLOW_OK;
+}
+
+static GstFlowReturn push_frame(struct obj *self, AVFrame *frame)
+{
+	GstBuffer *out_buf;
+
+	if (self->verify)
+		return verify_frame(self, frame);
+
+	if (self->segment.rate < 0.0)
+		return collect_frame(self, frame);
+
+	out_buf = frame_to_buffer(self, frame);
+	if (!out_buf)
+		return GST_FLOW_OK;
+
+	return push(self, out_buf);
+}
+
+static GstIndex *get_index(GstElement *element)
+{
+	struct obj *self = (struct obj *)element;
+	GstIndex *index;
+
+	GST_OBJECT_LOCK(self);
+	index = self->index ? gst_object_ref(self->index) : NULL;
+	GST_OBJECT_UNLOCK(self);
+
+	return index;
+}
+
+static void set_index(GstElement *element, GstIndex *index)
+{
+	struct obj *self = (struct obj *)element;
+	GstIndex *old;
+
+	GST_OBJECT_LOCK(self);
+	old = self->index;
+	self->index = index ? gst_object_ref(index) : NULL;
+	GST_OBJECT_UNLOCK(self);
+
+	if (old)
+		gst_object_unref(old);
+
+	if (index)
+		gst_index_get_writer_id(index, GST_OBJECT(self), &self->index_id);
+}
+
+static void add_index_entry(struct obj *self, GstBuffer *buf)
+{
+	GstIndex *index;
+	GstIndexEntry *entry;
+
+	if (GST_BUFFER_FLAG_IS_SET(buf, GST_BUFFER_FLAG_DELTA_UNIT))
+		return;
+	if (!GST_CLOCK_TIME_IS_VALID(buf->timestamp))
+		return;
+
+	index = get_index((GstElement *)self);
+	if (!index)
+		return;
+
+	/* already known from a previous pass */
+	entry = gst_index_get_assoc_entry(index, self->index_id,
+			GST_INDEX_LOOKUP_EXACT, GST_ASSOCIATION_FLAG_KEY_UNIT,
+			GST_FORMAT_TIME, buf->timestamp);
+	if (entry)
+		goto leave;
+
+	if (GST_BUFFER_OFFSET(buf) != GST_BUFFER_OFFSET_NONE)
+		gst_index_add_association(index, self->index_id,
+				GST_ASSOCIATION_FLAG_KEY_UNIT,
+				GST_FORMAT_TIME, buf->timestamp,
+				GST_FORMAT_BYTES, GST_BUFFER_OFFSET(buf),
+				NULL);
+	else
+		gst_index_add_association(index, self->index_id,
+				GST_ASSOCIATION_FLAG_KEY_UNIT,
+				GST_FORMAT_TIME, buf->timestamp,
+				NULL);
+
+leave:
+	gst_object_unref(index);
+}
+
+/* find the closest key frame at or before 'value' */
+static bool index_lookup(struct obj *self, GstFormat format, gint64 value,
+		GstFormat dest_format, gint64 *dest_value)
+{
+	GstIndex *index;
+	GstIndexEntry *entry;
+	bool found = false;
+
+	index = get_index((GstElement *)self);
+	if (!index)
+		return false;
+
+	entry = gst_index_get_assoc_entry(index, self->index_id,
+			GST_INDEX_LOOKUP_BEFORE, GST_ASSOCIATION_FLAG_KEY_UNIT,
+			format, value);
+	if (entry)
+		found = gst_index_entry_assoc_map(entry, dest_format, dest_value);
+
+	gst_object_unref(index);
+
+	return found;
+}
+
+/* the first and last indexed key frames */
+static bool index_range(struct obj *self, gint64 *first, gint64 *last)
+{
+	GstIndex *index;
+	GstIndexEntry *entry;
+	bool found = false;
+
+	index = get_index((GstElement *)self);
+	if (!index)
+		return false;
+
+	entry = gst_index_get_assoc_entry(index, self->index_id,
+			GST_INDEX_LOOKUP_AFTER, GST_ASSOCIATION_FLAG_KEY_UNIT,
+			GST_FORMAT_TIME, 0);
+	if (!entry || !gst_index_entry_assoc_map(entry, GST_FORMAT_TIME, first))
+		goto leave;
+
+	entry = gst_index_get_assoc_entry(index, self->index_id,
+			GST_INDEX_LOOKUP_BEFORE, GST_ASSOCIATION_FLAG_KEY_UNIT,
+			GST_FORMAT_TIME, G_MAXINT64);
+	if (!entry || !gst_index_entry_assoc_map(entry, GST_FORMAT_TIME, last))
+		goto leave;
+
+	found = true;
+
+leave:
+	gst_object_unref(index);
+
+	return found;
+}
+
+/*
+ * The delay is the packets that went in after the one a picture came from,
+ * so packets that never produce one (invisible frames, first fields) don't
+ * add up.
+ */
+static void count_packet(struct obj *self, int64_t pts)
+{
+	self->delay_pts[self->packets++ % ARRAY_SIZE(self->delay_pts)] = pts;
+}
+
+static void count_picture(struct obj *self, AVFrame *frame)
+{
+	unsigned n = MIN(self->packets, ARRAY_SIZE(self->delay_pts));
+	int delay = -1;
+
+	for (unsigned i = 1; i <= n; i++) {
+		int64_t pts = self->delay_pts[(self->packets - i) % ARRAY_SIZE(self->delay_pts)];
+		if (pts == (int64_t)AV_NOPTS_VALUE)
+			continue;
+#if LIBAVCODEC_VERSION_MAJOR < 53
+		if (pts == frame->reordered_opaque) {
+#else
+		if (pts == frame->pkt_pts || pts == frame->pkt_dts) {
+#endif
+			delay = i - 1;
+			break;
+		}
+	}
+
+	if (delay > self->max_delay) {
+		self->max_delay = delay;
+		if (self->max_delay > self->reported_delay)
+			gst_element_post_message(GST_ELEMENT(self),
+					gst_message_new_latency(GST_OBJECT(self)));
+	}
+}
+
+static GstFlowReturn decode(struct obj *self, GstBuffer *buf)
 {
-	struct obj *self;
 	GstFlowReturn ret = GST_FLOW_OK;
-	AVCodecContext *ctx;
-	AVFrame *frame = NULL;
+	AVCodecContext *ctx = self->av_ctx;
+	AVFrame *frame;
 	int got_pic;
 	AVPacket pkt;
 	int read;
+	bool preroll;
+
+	av_new_packet(&pkt, buf->size);
+
+	memcpy(pkt.data, buf->data, buf->size);
+	memset(pkt.data + pkt.size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+
+	frame = avcodec_alloc_frame();
+
+	pkt.dts = pkt.pts = gstav_timestamp_to_pts(ctx, buf->timestamp);
+#if LIBAVCODEC_VERSION_MAJOR < 53
+	ctx->reordered_opaque = pkt.dts;
+#endif
+
+	/*
+	 * Pre-roll for an accurate seek: no need to output these, and
+	 * non-reference frames don't need to be decoded at all, unless the
+	 * timestamps are DTS, then they might come after the start.
+	 */
+	preroll = before_segment(self, buf->timestamp);
+	ctx->skip_frame = self->discard;
+	if (preroll && self->bad_pts <= self->bad_dts &&
+			ctx->skip_frame < AVDISCARD_NONREF)
+		ctx->skip_frame = AVDISCARD_NONREF;
+
+	/* in reverse the frames are held for a while */
+	self->preroll = preroll || self->segment.rate < 0.0;
+
+	/* with NAL alignment, counted per access unit */
+	if ((!self->nal_aligned || self->au_new) && ctx->skip_frame <= AVDISCARD_DEFAULT)
+		count_packet(self, pkt.pts);
+	self->au_new = false;
+
+	g_mutex_lock(&self->mutex);
+	read = avcodec_decode_video2(ctx, frame, &got_pic, &pkt);
+	g_mutex_unlock(&self->mutex);
+	av_free_packet(&pkt);
+	if (read < 0) {
+		GST_WARNING_OBJECT(self, "error: %i", read);
+		if (self->recovery != RECOVERY_NONE && !self->waiting_sync) {
+			self->waiting_sync = true;
+			self->discarded = 0;
+		}
+		goto leave;
+	}
+
+	/* a seek started while decoding, abandon the frame */
+	if (g_atomic_int_get(&self->flushing)) {
+		ret = GST_FLOW_WRONG_STATE;
+		goto leave;
+	}
+
+	if (!got_pic && self->low_delay)
+		GST_DEBUG_OBJECT(self, "no frame out of the packet in low-delay mode");
+
+	if (got_pic) {
+		count_picture(self, frame);
+		ret = push_frame(self, frame);
+	}
+
+leave:
+	av_free(frame);
+
+	return ret;
+}
+
+static bool is_sync_point(struct obj *self, GstBuffer *buf, int *recovery_frames)
+{
+	bool idr;
+	bool key = !GST_BUFFER_FLAG_IS_SET(buf, GST_BUFFER_FLAG_DELTA_UNIT);
+
+	*recovery_frames = 0;
+
+	if (self->codec->id != CODEC_ID_H264)
+		return key;
+
+	/* demuxers also flag non-IDR key frames */
+	if (!gst_av_h264_sync_point(self, buf, &idr, recovery_frames))
+		return key;
+
+	if (idr) {
+		*recovery_frames = 0;
+		return true;
+	}
+
+	/* when joining, fast-start decides */
+	return key || self->recovery == RECOVERY_POINT || self->joining;
+}
+
+/*
+ * In key frame only mode, there's no point in decoding more key frames than
+ * can be shown at normal speed.
+ */
+static bool trick_skip(struct obj *self, GstBuffer *buf)
+{
+	GstClockTime ts = buf->timestamp;
+
+	if (self->discard < AVDISCARD_NONKEY)
+		return false;
+
+	if (GST_BUFFER_FLAG_IS_SET(buf, GST_BUFFER_FLAG_DELTA_UNIT))
+		return true;
+
+	if (!GST_CLOCK_TIME_IS_VALID(ts))
+		return false;
+
+	if (GST_CLOCK_TIME_IS_VALID(self->last_key) && ts > self->last_key &&
+			ts - self->last_key < frame_duration(self) * self->segment.rate)
+		return true;
+
+	self->last_key = ts;
+	return false;
+}
+
+static void set_trick_mode(struct obj *self)
+{
+	gdouble rate = self->segment.rate;
+	enum AVDiscard discard = AVDISCARD_DEFAULT;
+
+	/* with the skip flag, upstream doesn't care about smoothness */
+	if (self->seek_skip)
+		rate *= 2.0;
+
+	if (rate > 4.0)
+		discard = AVDISCARD_NONKEY;
+	else if (rate > 2.0)
+		discard = AVDISCARD_NONREF;
+
+	if (discard != self->discard)
+		GST_INFO_OBJECT(self, "rate %g, discard level %i",
+				self->segment.rate, discard);
+
+	self->discard = discard;
+	self->last_key = GST_CLOCK_TIME_NONE;
+	self->last_out = GST_CLOCK_TIME_NONE;
+}
+
+static void clear_reverse(struct obj *self)
+{
+	GstBuffer *buf;
+
+	while ((buf = g_queue_pop_head(&self->gop)))
+		gst_buffer_unref(buf);
+	while ((buf = g_queue_pop_head(&self->rev_frames)))
+		gst_buffer_unref(buf);
+	self->rev_bytes = 0;
+}
+
+/*
+ * Decode the gathered GOP forward and push its frames backwards. If they
+ * don't all fit in memory, decode it again for each chunk, from the end.
+ */
+static GstFlowReturn flush_gop(struct obj *self)
+{
+	GstFlowReturn ret = GST_FLOW_OK;
+	GstBuffer *out_buf;
+	int n = 0;
+	bool first_pass = true;
+
+	self->rev_lo = 0;
+	self->rev_hi = G_MAXINT;
+
+	while (true) {
+		GList *l;
+		bool discont = true;
+
+		g_mutex_lock(&self->mutex);
+		avcodec_flush_buffers(self->av_ctx);
+		g_mutex_unlock(&self->mutex);
+
+		self->rev_idx = 0;
+		for (l = self->gop.head; l; l = l->next) {
+			ret = decode(self, l->data);
+			if (ret != GST_FLOW_OK)
+				goto leave;
+		}
+		get_delayed(self);
+
+		if (first_pass) {
+			out_buf = g_queue_peek_head(&self->rev_frames);
+			n = self->rev_frames.length;
+			self->rev_hi = out_buf ? GST_BUFFER_OFFSET(out_buf) : 0;
+			if (self->rev_hi > 0)
+				GST_DEBUG_OBJECT(self, "%i frames don't fit, decoding in passes",
+						self->rev_idx);
+			first_pass = false;
+		} else {
+			self->rev_hi = self->rev_lo;
+		}
+
+		while ((out_buf = g_queue_pop_tail(&self->rev_frames))) {
+			self->rev_bytes -= out_buf->size;
+			GST_BUFFER_OFFSET(out_buf) = GST_BUFFER_OFFSET_NONE;
+			if (discont)
+				GST_BUFFER_FLAG_SET(out_buf, GST_BUFFER_FLAG_DISCONT);
+			discont = false;
+			ret = push(self, out_buf);
+			if (ret != GST_FLOW_OK)
+				goto leave;
+		}
+
+		if (self->rev_hi <= 0 || n == 0)
+			break;
+
+		self->rev_lo = MAX(0, self->rev_hi - n);
+	}
+
+leave:
+	g_mutex_lock(&self->mutex);
+	avcodec_flush_buffers(self->av_ctx);
+	g_mutex_unlock(&self->mutex);
+	clear_reverse(self);
+
+	return ret;
+}
+
+static void clear_replay(struct obj *self)
+{
+	GstBuffer *buf;
+
+	while ((buf = g_queue_pop_head(&self->replay_pkts)))
+		gst_buffer_unref(buf);
+}
+
+/*
+ * After a seek, push the frames from the cache until the first miss, then
+ * decode again starting from the last key frame, without output.
+ */
+static bool replay(struct obj *self, GstBuffer *buf, GstFlowReturn *ret)
+{
+	AVCodecContext *ctx = self->av_ctx;
+	GstBuffer *out_buf;
+
+	/* frames don't come out in input order */
+	if (ctx->has_b_frames) {
+		self->replay = false;
+		return false;
+	}
+
+	out_buf = gst_av_cache_lookup(self->cache, buf->timestamp);
+	if (!out_buf) {
+		GstBuffer *pkt;
+
+		self->cache_misses++;
+		self->replay = false;
+
+		enum AVDiscard discard = self->discard;
+
+		if (discard < AVDISCARD_NONREF)
+			self->discard = AVDISCARD_NONREF;
+		while ((pkt = g_queue_pop_head(&self->replay_pkts))) {
+			*ret = decode(self, pkt);
+			gst_buffer_unref(pkt);
+			if (*ret != GST_FLOW_OK)
+				break;
+		}
+		self->discard = discard;
+
+		if (*ret != GST_FLOW_OK)
+			return true;
+
+		return false;
+	}
+
+	self->cache_hits++;
+
+	if (!GST_BUFFER_FLAG_IS_SET(buf, GST_BUFFER_FLAG_DELTA_UNIT))
+		clear_replay(self);
+	g_queue_push_tail(&self->replay_pkts, gst_buffer_ref(buf));
+
+	self->replay_last = out_buf->timestamp;
+
+	/* same as when decoding */
+	if (before_segment(self, out_buf->timestamp)) {
+		GST_LOG_OBJECT(self, "skipping cached frame before segment start");
+		gst_buffer_unref(out_buf);
+		return true;
+	}
+
+	*ret = push(self, out_buf);
+
+	return true;
+}
+
+static GstFlowReturn
+pad_chain(GstPad *pad, GstBuffer *buf)
+{
+	struct obj *self;
+	GstFlowReturn ret = GST_FLOW_OK;
+	AVCodecContext *ctx;
 
 	self = (struct obj *)((GstObject *)pad)->parent;
 	ctx = self->av_ctx;
 
-	if (G_UNLIKELY(!self->initialized)) {
-		GstCaps *new_caps;
-		GstStructure *struc;
+	if (g_atomic_int_get(&self->flushing)) {
+		ret = GST_FLOW_WRONG_STATE;
+		goto leave;
+	}
 
+	if (G_UNLIKELY(!self->initialized)) {
 		self->initialized = true;
-		if (gst_av_codec_open(ctx, self->codec) < 0) {
-			ret = GST_FLOW_ERROR;
-			goto leave;
+		if (!self->opened) {
+			if (gst_av_codec_open(ctx, self->codec) < 0) {
+				ret = GST_FLOW_ERROR;
+				goto leave;
+			}
+			self->opened = true;
 		}
 
 		if (self->parse_func)
 			self->parse_func(self, buf);
 
-		new_caps = gst_caps_new_empty();
-
-		struc = gst_structure_new("video/x-raw-yuv",
-				"width", G_TYPE_INT, ctx->width,
-				"height", G_TYPE_INT, ctx->height,
-				"format", GST_TYPE_FOURCC, GST_MAKE_FOURCC('I','4','2','0'),
-				NULL);
+		set_src_caps(self);
 
-		if (ctx->time_base.num)
-			gst_structure_set(struc,
-					"framerate", GST_TYPE_FRACTION,
-					ctx->time_base.den,
-					ctx->time_base.num * ctx->ticks_per_frame,
-					NULL);
+		self->join_start = g_get_monotonic_time();
+		self->skip_frames = 0;
+		self->join_discarded = 0;
+		if (self->fast_start != FAST_START_NONE) {
+			self->waiting_sync = true;
+			self->joining = true;
+			self->discarded = 0;
+		}
+	}
 
-		if (ctx->sample_aspect_ratio.num)
-			gst_structure_set(struc,
-					"pixel-aspect-ratio", GST_TYPE_FRACTION,
-					ctx->sample_aspect_ratio.num, ctx->sample_aspect_ratio.den,
-					NULL);
+	add_index_entry(self, buf);
+
+	/* after an error, the following frames would reference missing ones */
+	if (self->waiting_sync) {
+		int recovery_frames;
+
+		if (is_sync_point(self, buf, &recovery_frames)) {
+			GST_INFO_OBJECT(self, "recovered, %u frames discarded", self->discarded);
+			self->waiting_sync = false;
+
+			if (!self->joining || self->fast_start != FAST_START_PARTIAL)
+				self->skip_frames = recovery_frames;
+			self->joining = false;
+		} else {
+			int type = self->nal_aligned ? gst_av_h264_nal_type(self, buf) : -1;
+
+			/* in-band parameter sets are needed to decode the sync point */
+			if (type != 7 && type != 8) {
+				/* only slices count as frames */
+				if (!self->nal_aligned || (type >= 1 && type <= 5)) {
+					self->discarded++;
+					if (self->joining)
+						self->join_discarded++;
+					else
+						self->total_discarded++;
+				}
+				goto leave;
+			}
+		}
+	}
 
-		gst_caps_append_structure(new_caps, struc);
+	if (trick_skip(self, buf))
+		goto leave;
 
-		GST_INFO_OBJECT(self, "caps are: %" GST_PTR_FORMAT, new_caps);
-		gst_pad_set_caps(self->srcpad, new_caps);
-		gst_caps_unref(new_caps);
+	/* upstream sends each GOP forward, starting with a discont */
+	if (self->segment.rate < 0.0) {
+		if (GST_BUFFER_FLAG_IS_SET(buf, GST_BUFFER_FLAG_DISCONT) && self->gop.length)
+			ret = flush_gop(self);
+		g_queue_push_tail(&self->gop, gst_buffer_ref(buf));
+		goto leave;
 	}
 
-	av_new_packet(&pkt, buf->size);
-
-	memcpy(pkt.data, buf->data, buf->size);
-	memset(pkt.data + pkt.size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+	if (self->replay && replay(self, buf, &ret))
+		goto leave;
 
-	frame = avcodec_alloc_frame();
+	if (self->nal_aligned) {
+		if (gst_av_h264_au_start(self, buf))
+			self->au_new = true;
 
-	pkt.dts = pkt.pts = gstav_timestamp_to_pts(ctx, buf->timestamp);
-#if LIBAVCODEC_VERSION_MAJOR < 53
-	ctx->reordered_opaque = pkt.dts;
-#endif
+		/* measured from the first slice of the access unit */
+		if (self->low_delay && !self->chain_start)
+			self->chain_start = g_get_monotonic_time();
 
-	g_mutex_lock(&self->mutex);
-	read = avcodec_decode_video2(ctx, frame, &got_pic, &pkt);
-	g_mutex_unlock(&self->mutex);
-	av_free_packet(&pkt);
-	if (read < 0) {
-		GST_WARNING_OBJECT(self, "error: %i", read);
+		ret = decode(self, buf);
 		goto leave;
 	}
 
-	if (got_pic) {
-		GstBuffer *out_buf;
-		out_buf = convert_frame(self, frame);
-		ret = gst_pad_push(self->srcpad, out_buf);
-	}
+	if (self->low_delay)
+		self->chain_start = g_get_monotonic_time();
+
+	ret = decode(self, buf);
+	self->chain_start = 0;
 
 leave:
-	av_free(frame);
 	gst_buffer_unref(buf);
 
 	return ret;
 }
 
+static void release_context(struct obj *self)
+{
+	AVCodecContext *ctx = self->av_ctx;
+
+	if (!ctx)
+		return;
+
+	if (self->opened && self->pool_size) {
+		/* keep it warm for the next stream */
+		gst_av_codec_pool_put(ctx, &self->pool_key, self->pool_size);
+		self->av_ctx = NULL;
+	} else {
+		gst_av_codec_close(ctx);
+		av_freep(&ctx->extradata);
+		av_freep(&self->av_ctx);
+	}
+
+	self->opened = false;
+}
+
 static GstStateChangeReturn
 change_state(GstElement *element, GstStateChange transition)
 {
@@ -259,6 +1272,9 @@ change_state(GstElement *element, GstStateChange transition)
 	switch (transition) {
 	case GST_STATE_CHANGE_NULL_TO_READY:
 		self->initialized = false;
+		self->cache_hits = self->cache_misses = 0;
+		self->total_discarded = 0;
+		self->verify_frames = 0;
 		break;
 
 	default:
@@ -271,11 +1287,28 @@ change_state(GstElement *element, GstStateChange transition)
 		return ret;
 
 	switch (transition) {
+	case GST_STATE_CHANGE_PAUSED_TO_READY:
+		self->replay = false;
+		self->waiting_sync = false;
+		self->joining = false;
+		self->join_start = 0;
+		clear_replay(self);
+		gst_av_cache_clear(self->cache);
+		clear_reverse(self);
+		gst_segment_init(&self->segment, GST_FORMAT_TIME);
+		self->seek_skip = false;
+		set_trick_mode(self);
+		break;
+
 	case GST_STATE_CHANGE_READY_TO_NULL:
-		if (self->av_ctx) {
-			gst_av_codec_close(self->av_ctx);
-			av_freep(&self->av_ctx->extradata);
-			av_freep(&self->av_ctx);
+		release_context(self);
+		if (self->sws) {
+			sws_freeContext(self->sws);
+			self->sws = NULL;
+		}
+		if (self->verify_file) {
+			fclose(self->verify_file);
+			self->verify_file = NULL;
 		}
 		break;
 
@@ -333,15 +1366,21 @@ sink_setcaps(GstPad *pad, GstCaps *caps)
 	self = (struct obj *)((GstObject *)pad)->parent;
 	ctx = self->av_ctx;
 
+	self->nal_length_size = 0;
+	self->nal_aligned = false;
+	self->vcl_seen = false;
+	self->packets = self->max_delay = 0;
+
 	if (ctx) {
 		/* reset */
 		get_delayed(self);
-		gst_av_codec_close(ctx);
-		av_freep(&ctx->extradata);
-		av_freep(&self->av_ctx);
+		release_context(self);
 		self->initialized = false;
 	}
 
+	/* frames of a previous stream are of no use */
+	gst_av_cache_clear(self->cache);
+
 	in_struc = gst_caps_get_structure(caps, 0);
 
 	name = gst_structure_get_name(in_struc);
@@ -349,6 +1388,10 @@ sink_setcaps(GstPad *pad, GstCaps *caps)
 		codec_id = CODEC_ID_H263;
 	else if (strcmp(name, "video/x-h264") == 0)
 		codec_id = CODEC_ID_H264;
+#ifdef HAVE_HEVC
+	else if (strcmp(name, "video/x-h265") == 0)
+		codec_id = AV_CODEC_ID_HEVC;
+#endif
 	else if (strcmp(name, "video/mpeg") == 0) {
 		int version;
 		gst_structure_get_int(in_struc, "mpegversion", &version);
@@ -391,6 +1434,8 @@ sink_setcaps(GstPad *pad, GstCaps *caps)
 		codec_id = CODEC_ID_VP8;
 	else if (strcmp(name, "video/x-theora") == 0)
 		codec_id = CODEC_ID_THEORA;
+	else if (strcmp(name, "image/jpeg") == 0)
+		codec_id = CODEC_ID_MJPEG;
 	else if (strcmp(name, "video/x-wmv") == 0) {
 		int version;
 		gst_structure_get_int(in_struc, "wmvversion", &version);
@@ -429,12 +1474,46 @@ sink_setcaps(GstPad *pad, GstCaps *caps)
 	case CODEC_ID_H263:
 		self->parse_func = gst_av_h263_parse;
 		break;
-	case CODEC_ID_H264:
+	case CODEC_ID_H264: {
+		const char *alignment;
+
+		alignment = gst_structure_get_string(in_struc, "alignment");
+		if (alignment && strcmp(alignment, "nal") == 0)
+			self->nal_aligned = true;
 		self->parse_func = gst_av_h264_parse;
 		break;
+	}
+#ifdef HAVE_HEVC
+	case AV_CODEC_ID_HEVC:
+		self->parse_func = gst_av_h265_parse;
+		break;
+#endif
 	case CODEC_ID_MPEG4:
 		self->parse_func = gst_av_mpeg4_parse;
 		break;
+	case CODEC_ID_MPEG1VIDEO:
+	case CODEC_ID_MPEG2VIDEO:
+		self->parse_func = gst_av_mpeg2_parse;
+		break;
+	case CODEC_ID_VC1:
+		self->parse_func = gst_av_vc1_parse;
+		break;
+	case CODEC_ID_WMV3:
+		/* simple and main profile have no sequence header in the stream */
+		self->parse_func = NULL;
+		break;
+	case CODEC_ID_VP8:
+		self->parse_func = gst_av_vp8_parse;
+		break;
+	case CODEC_ID_THEORA:
+		self->parse_func = gst_av_theora_parse;
+		break;
+	case CODEC_ID_MJPEG:
+		self->parse_func = gst_av_jpeg_parse;
+		break;
+	default:
+		self->parse_func = NULL;
+		break;
 	}
 
 	self->av_ctx = ctx = avcodec_alloc_context3(self->codec);
@@ -445,6 +1524,44 @@ sink_setcaps(GstPad *pad, GstCaps *caps)
 	ctx->opaque = self;
 	ctx->flags |= CODEC_FLAG_EMU_EDGE;
 
+	/* slices are fed as they come, libav finds the frame boundaries */
+	if (self->nal_aligned)
+		ctx->flags2 |= CODEC_FLAG2_CHUNKS;
+#ifdef CODEC_FLAG2_SHOW_ALL
+	if (self->fast_start == FAST_START_PARTIAL)
+		ctx->flags2 |= CODEC_FLAG2_SHOW_ALL;
+#endif
+
+	switch (codec_id) {
+#ifdef HAVE_HEVC
+	case AV_CODEC_ID_HEVC:
+		/* slice threads are used for WPP */
+		ctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+		ctx->thread_count = self->max_threads;
+		break;
+#endif
+	case CODEC_ID_MJPEG:
+		/* libav's MJPEG decoder has no threads, frames are decoded one by one */
+		break;
+	default:
+		if (self->max_threads)
+			ctx->thread_count = self->max_threads;
+		break;
+	}
+
+	/* no reordering, and frame threads would hold frames */
+	if (self->low_delay) {
+		ctx->flags |= CODEC_FLAG_LOW_DELAY;
+		ctx->flags2 |= CODEC_FLAG2_FAST;
+		ctx->thread_type = FF_THREAD_SLICE;
+	}
+
+	/* bands are only reported without frame threads */
+	if (self->band_events) {
+		ctx->draw_horiz_band = draw_band;
+		ctx->thread_type = FF_THREAD_SLICE;
+	}
+
 	gst_structure_get_int(in_struc, "width", &ctx->width);
 	gst_structure_get_int(in_struc, "height", &ctx->height);
 
@@ -459,7 +1576,17 @@ sink_setcaps(GstPad *pad, GstCaps *caps)
 		ctx->time_base = (AVRational){ 1, 0 };
 
 	if (codec_id == CODEC_ID_THEORA) {
+		const GValue *array;
+
 		get_theora_extradata(ctx, in_struc);
+
+		/* the identification header comes first */
+		array = gst_structure_get_value(in_struc, "streamheader");
+		if (array && gst_value_array_get_size(array) > 0) {
+			buf = gst_value_get_buffer(gst_value_array_get_value(array, 0));
+			if (buf)
+				self->parse_func(self, buf);
+		}
 		goto next;
 	}
 
@@ -478,17 +1605,49 @@ sink_setcaps(GstPad *pad, GstCaps *caps)
 		self->parse_func(self, buf);
 
 next:
+	gst_av_codec_pool_key(ctx, &self->pool_key);
+
+	if (self->pool_size) {
+		AVCodecContext *pooled;
+
+		pooled = gst_av_codec_pool_get(ctx);
+		if (pooled) {
+			GST_DEBUG_OBJECT(self, "using pooled context");
+			pooled->opaque = self;
+			pooled->width = ctx->width;
+			pooled->height = ctx->height;
+			pooled->sample_aspect_ratio = ctx->sample_aspect_ratio;
+			pooled->time_base = ctx->time_base;
+			av_freep(&ctx->extradata);
+			av_freep(&self->av_ctx);
+			self->av_ctx = pooled;
+			self->opened = true;
+		}
+	}
+
 	return true;
 }
 
 static GstCaps *
 generate_src_template(void)
 {
-	GstCaps *caps = NULL;
+	GstCaps *caps;
 
-	caps = gst_caps_new_simple("video/x-raw-yuv",
-			"format", GST_TYPE_FOURCC, GST_MAKE_FOURCC('I', '4', '2', '0'),
-			NULL);
+	caps = gst_caps_new_empty();
+
+	for (unsigned i = 0; i < ARRAY_SIZE(formats); i++) {
+		GstStructure *struc;
+
+		/* JPEG variants map to the same fourcc */
+		if (i > 0 && formats[i].fourcc == formats[i - 1].fourcc)
+			continue;
+
+		struc = gst_structure_new("video/x-raw-yuv",
+				"format", GST_TYPE_FOURCC, formats[i].fourcc,
+				NULL);
+
+		gst_caps_append_structure(caps, struc);
+	}
 
 	return caps;
 }
@@ -512,6 +1671,20 @@ generate_sink_template(void)
 
 	gst_caps_append_structure(caps, struc);
 
+	struc = gst_structure_new("video/x-h264",
+			"alignment", G_TYPE_STRING, "nal",
+			NULL);
+
+	gst_caps_append_structure(caps, struc);
+
+#ifdef HAVE_HEVC
+	struc = gst_structure_new("video/x-h265",
+			"alignment", G_TYPE_STRING, "au",
+			NULL);
+
+	gst_caps_append_structure(caps, struc);
+#endif
+
 	struc = gst_structure_new("video/mpeg",
 			NULL);
 
@@ -547,6 +1720,11 @@ generate_sink_template(void)
 
 	gst_caps_append_structure(caps, struc);
 
+	struc = gst_structure_new("image/jpeg",
+			NULL);
+
+	gst_caps_append_structure(caps, struc);
+
 	return caps;
 }
 
@@ -564,11 +1742,12 @@ static void get_delayed(struct obj *self)
 
 	do {
 		GstFlowReturn ret;
+		if (g_atomic_int_get(&self->flushing))
+			break;
 		avcodec_decode_video2(self->av_ctx, frame, &got_pic, &pkt);
 		if (got_pic) {
-			GstBuffer *out_buf;
-			out_buf = convert_frame(self, frame);
-			ret = gst_pad_push(self->srcpad, out_buf);
+			count_picture(self, frame);
+			ret = push_frame(self, frame);
 			if (ret != GST_FLOW_OK)
 				break;
 		}
@@ -586,12 +1765,52 @@ static gboolean sink_event(GstPad *pad, GstEvent *event)
 
 	switch (GST_EVENT_TYPE(event)) {
 	case GST_EVENT_EOS:
+		if (self->gop.length)
+			flush_gop(self);
 		get_delayed(self);
+		/* the report is complete */
+		if (self->verify_file)
+			fflush(self->verify_file);
+		break;
+	case GST_EVENT_NEWSEGMENT: {
+		gboolean update;
+		gdouble rate, applied_rate;
+		GstFormat format;
+		gint64 start, stop, position;
+
+		gst_event_parse_new_segment_full(event, &update, &rate, &applied_rate,
+				&format, &start, &stop, &position);
+		/* only time segments are tracked, others pass as they are */
+		if (format == GST_FORMAT_TIME)
+			gst_segment_set_newsegment_full(&self->segment, update, rate,
+					applied_rate, format, start, stop, position);
+		else
+			gst_segment_init(&self->segment, GST_FORMAT_TIME);
+		set_trick_mode(self);
 		break;
+	}
 	case GST_EVENT_FLUSH_START:
+		/*
+		 * The decode call in flight still completes, and the seek waits for
+		 * it on the stream lock; only its conversion and push are skipped.
+		 */
+		g_atomic_int_set(&self->flushing, 1);
+		self->flush_time = g_get_monotonic_time();
+		break;
+	case GST_EVENT_FLUSH_STOP:
+		/* the streaming thread is stopped by now */
 		g_mutex_lock(&self->mutex);
-		avcodec_flush_buffers(self->av_ctx);
+		if (self->av_ctx)
+			avcodec_flush_buffers(self->av_ctx);
 		g_mutex_unlock(&self->mutex);
+		g_atomic_int_set(&self->flushing, 0);
+		clear_replay(self);
+		self->replay_last = GST_CLOCK_TIME_NONE;
+		/* the cache works with whole frames */
+		self->replay = self->cache_size > 0 && !self->nal_aligned;
+		clear_reverse(self);
+		gst_segment_init(&self->segment, GST_FORMAT_TIME);
+		self->packets = 0;
 		break;
 	default:
 		break;
@@ -604,6 +1823,181 @@ static gboolean sink_event(GstPad *pad, GstEvent *event)
 	return ret;
 }
 
+static gboolean src_event(GstPad *pad, GstEvent *event)
+{
+	struct obj *self;
+	gboolean ret;
+
+	self = (struct obj *)(gst_pad_get_parent(pad));
+
+	switch (GST_EVENT_TYPE(event)) {
+	case GST_EVENT_SEEK: {
+		gdouble rate;
+		GstFormat format;
+		GstSeekFlags flags;
+		GstSeekType start_type, stop_type;
+		gint64 start, stop, key_start;
+
+		gst_event_parse_seek(event, &rate, &format, &flags,
+				&start_type, &start, &stop_type, &stop);
+
+		self->seek_skip = flags & GST_SEEK_FLAG_SKIP;
+
+		if (format != GST_FORMAT_TIME || start_type != GST_SEEK_TYPE_SET)
+			break;
+		if (!(flags & GST_SEEK_FLAG_KEY_UNIT) || rate < 0.0)
+			break;
+
+		/* land on the indexed key frame so upstream doesn't have to probe */
+		if (!index_lookup(self, GST_FORMAT_TIME, start, GST_FORMAT_TIME, &key_start))
+			break;
+
+		GST_DEBUG_OBJECT(self, "seeking to key frame at %" GST_TIME_FORMAT,
+				GST_TIME_ARGS(key_start));
+
+		gst_event_unref(event);
+		event = gst_event_new_seek(rate, format, flags,
+				start_type, key_start, stop_type, stop);
+		break;
+	}
+	default:
+		break;
+	}
+
+	ret = gst_pad_push_event(self->sinkpad, event);
+
+	gst_object_unref(self);
+
+	return ret;
+}
+
+/* in frames */
+static int decoder_delay(struct obj *self)
+{
+	AVCodecContext *ctx = self->av_ctx;
+	int delay;
+
+	if (!ctx)
+		return 0;
+
+	delay = ctx->has_b_frames;
+#if LIBAVCODEC_VERSION_MAJOR >= 53
+	if (ctx->active_thread_type & FF_THREAD_FRAME)
+		delay += ctx->thread_count - 1;
+#endif
+
+	return MAX(delay, self->max_delay);
+}
+
+static gboolean src_query(GstPad *pad, GstQuery *query)
+{
+	struct obj *self;
+	gboolean ret;
+
+	self = (struct obj *)(gst_pad_get_parent(pad));
+
+	switch (GST_QUERY_TYPE(query)) {
+	case GST_QUERY_CONVERT: {
+		GstFormat src_format, dest_format;
+		gint64 src_value, dest_value;
+		AVCodecContext *ctx = self->av_ctx;
+		guint64 num, den;
+
+		gst_query_parse_convert(query, &src_format, &src_value, &dest_format, NULL);
+
+		/* frames and time, from the frame rate; the rest upstream */
+		if (!ctx || !ctx->time_base.num || !ctx->time_base.den)
+			break;
+
+		num = (guint64)GST_SECOND * ctx->time_base.num * ctx->ticks_per_frame;
+		den = ctx->time_base.den;
+
+		if (src_format == GST_FORMAT_DEFAULT && dest_format == GST_FORMAT_TIME)
+			dest_value = gst_util_uint64_scale(src_value, num, den);
+		else if (src_format == GST_FORMAT_TIME && dest_format == GST_FORMAT_DEFAULT)
+			dest_value = gst_util_uint64_scale(src_value, den, num);
+		else
+			break;
+
+		if (src_value == -1)
+			dest_value = -1;
+
+		gst_query_set_convert(query, src_format, src_value, dest_format, dest_value);
+		ret = TRUE;
+		goto leave;
+	}
+	case GST_QUERY_LATENCY: {
+		gboolean live;
+		GstClockTime min, max, latency;
+		int delay;
+
+		ret = gst_pad_peer_query(self->sinkpad, query);
+		if (!ret)
+			goto leave;
+
+		gst_query_parse_latency(query, &live, &min, &max);
+
+		delay = decoder_delay(self);
+		latency = self->av_ctx ? delay * frame_duration(self) : 0;
+		self->reported_delay = delay;
+
+		GST_DEBUG_OBJECT(self, "latency %" GST_TIME_FORMAT " (%i frames)",
+				GST_TIME_ARGS(latency), delay);
+
+		min += latency;
+		if (GST_CLOCK_TIME_IS_VALID(max))
+			max += latency;
+
+		gst_query_set_latency(query, live, min, max);
+		goto leave;
+	}
+	case GST_QUERY_SEEKING: {
+		GstFormat format;
+		gboolean seekable = FALSE;
+		gint64 start = -1, end = -1, first, last;
+
+		gst_query_parse_seeking(query, &format, NULL, NULL, NULL);
+		if (format != GST_FORMAT_TIME)
+			break;
+
+		ret = gst_pad_peer_query(self->sinkpad, query);
+		if (ret)
+			gst_query_parse_seeking(query, NULL, &seekable, &start, &end);
+
+		if (!index_range(self, &first, &last))
+			goto leave;
+
+		/* the indexed key frames can be reached, fill in what upstream doesn't know */
+		if (!ret) {
+			seekable = TRUE;
+			start = first;
+			end = last;
+		} else if (seekable) {
+			if (start == -1)
+				start = first;
+			if (end == -1)
+				end = last;
+		}
+
+		GST_DEBUG_OBJECT(self, "seekable %i from %" GST_TIME_FORMAT " to %" GST_TIME_FORMAT,
+				seekable, GST_TIME_ARGS(start), GST_TIME_ARGS(end));
+
+		gst_query_set_seeking(query, format, seekable, start, end);
+		ret = TRUE;
+		goto leave;
+	}
+	default:
+		break;
+	}
+
+	ret = gst_pad_query_default(pad, query);
+
+leave:
+	gst_object_unref(self);
+
+	return ret;
+}
+
 static void
 instance_init(GTypeInstance *instance, void *g_class)
 {
@@ -619,6 +2013,9 @@ instance_init(GTypeInstance *instance, void *g_class)
 	self->srcpad =
 		gst_pad_new_from_template(gst_element_class_get_pad_template(element_class, "src"), "src");
 
+	gst_pad_set_event_function(self->srcpad, src_event);
+	gst_pad_set_query_function(self->srcpad, src_query);
+
 	gst_pad_use_fixed_caps(self->srcpad);
 
 	gst_element_add_pad((GstElement *)self, self->sinkpad);
@@ -626,16 +2023,152 @@ instance_init(GTypeInstance *instance, void *g_class)
 
 	gst_pad_set_setcaps_function(self->sinkpad, sink_setcaps);
 	g_mutex_init(&self->mutex);
+
+	self->cache = gst_av_cache_new();
+	self->replay_last = GST_CLOCK_TIME_NONE;
+	g_queue_init(&self->replay_pkts);
+	gst_segment_init(&self->segment, GST_FORMAT_TIME);
+	self->last_key = self->last_out = GST_CLOCK_TIME_NONE;
+	g_queue_init(&self->gop);
+	g_queue_init(&self->rev_frames);
+	self->rev_max_bytes = 64 * 1024 * 1024;
+	gst_av_codec_pool_ref();
 }
 
 static void
 finalize(GObject *obj)
 {
 	struct obj *self = (struct obj *)obj;
+	release_context(self);
+	gst_av_codec_pool_unref();
+	if (self->index)
+		gst_object_unref(self->index);
+	clear_replay(self);
+	clear_reverse(self);
+	g_free(self->verify_location);
+	gst_av_cache_free(self->cache);
 	g_mutex_clear(&self->mutex);
 	((GObjectClass *)parent_class)->finalize(obj);
 }
 
+static void
+set_property(GObject *obj, guint prop_id, const GValue *value, GParamSpec *pspec)
+{
+	struct obj *self = (struct obj *)obj;
+
+	switch (prop_id) {
+	case PROP_MAX_THREADS:
+		self->max_threads = g_value_get_int(value);
+		break;
+	case PROP_ERROR_RECOVERY:
+		self->recovery = g_value_get_enum(value);
+		break;
+	case PROP_FAST_START:
+		self->fast_start = g_value_get_enum(value);
+		break;
+	case PROP_POOL_SIZE:
+		self->pool_size = g_value_get_uint(value);
+		break;
+	case PROP_REVERSE_MEMORY:
+		self->rev_max_bytes = g_value_get_uint64(value);
+		break;
+	case PROP_LOW_DELAY:
+		self->low_delay = g_value_get_boolean(value);
+		break;
+	case PROP_BAND_EVENTS:
+		self->band_events = g_value_get_boolean(value);
+		break;
+	case PROP_VERIFY:
+		self->verify = g_value_get_boolean(value);
+		break;
+	case PROP_OUTPUT_WIDTH:
+		self->out_width = g_value_get_int(value);
+		break;
+	case PROP_OUTPUT_HEIGHT:
+		self->out_height = g_value_get_int(value);
+		break;
+	case PROP_VERIFY_LOCATION:
+		g_free(self->verify_location);
+		self->verify_location = g_value_dup_string(value);
+		break;
+	case PROP_CACHE_SIZE:
+		self->cache_size = g_value_get_uint64(value);
+		gst_av_cache_set_limit(self->cache, self->cache_size);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+get_property(GObject *obj, guint prop_id, GValue *value, GParamSpec *pspec)
+{
+	struct obj *self = (struct obj *)obj;
+
+	switch (prop_id) {
+	case PROP_MAX_THREADS:
+		g_value_set_int(value, self->max_threads);
+		break;
+	case PROP_CACHE_SIZE:
+		g_value_set_uint64(value, self->cache_size);
+		break;
+	case PROP_ERROR_RECOVERY:
+		g_value_set_enum(value, self->recovery);
+		break;
+	case PROP_FRAMES_DISCARDED:
+		g_value_set_uint(value, self->total_discarded);
+		break;
+	case PROP_FAST_START:
+		g_value_set_enum(value, self->fast_start);
+		break;
+	case PROP_JOIN_TIME:
+		g_value_set_int64(value, self->join_time);
+		break;
+	case PROP_JOIN_DISCARDED:
+		g_value_set_uint(value, self->join_discarded);
+		break;
+	case PROP_POOL_SIZE:
+		g_value_set_uint(value, self->pool_size);
+		break;
+	case PROP_REVERSE_MEMORY:
+		g_value_set_uint64(value, self->rev_max_bytes);
+		break;
+	case PROP_LOW_DELAY:
+		g_value_set_boolean(value, self->low_delay);
+		break;
+	case PROP_BAND_EVENTS:
+		g_value_set_boolean(value, self->band_events);
+		break;
+	case PROP_VERIFY:
+		g_value_set_boolean(value, self->verify);
+		break;
+	case PROP_OUTPUT_WIDTH:
+		g_value_set_int(value, self->out_width);
+		break;
+	case PROP_OUTPUT_HEIGHT:
+		g_value_set_int(value, self->out_height);
+		break;
+	case PROP_VERIFY_LOCATION:
+		g_value_set_string(value, self->verify_location);
+		break;
+	case PROP_FRAME_LATENCY:
+		g_value_set_int64(value, self->frame_latency);
+		break;
+	case PROP_SEEK_LATENCY:
+		g_value_set_int64(value, self->seek_latency);
+		break;
+	case PROP_CACHE_HIT_RATE: {
+		guint64 lookups = self->cache_hits + self->cache_misses;
+		g_value_set_double(value, lookups ? (double)self->cache_hits / lookups : 0.0);
+		break;
+	}
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+		break;
+	}
+}
+
 static void
 base_init(void *g_class)
 {
@@ -670,7 +2203,102 @@ class_init(void *g_class, void *class_data)
 	parent_class = g_type_class_ref(GST_TYPE_ELEMENT);
 
 	gstelement_class->change_state = change_state;
+	gstelement_class->set_index = set_index;
+	gstelement_class->get_index = get_index;
 	gobject_class->finalize = finalize;
+	gobject_class->set_property = set_property;
+	gobject_class->get_property = get_property;
+
+	g_object_class_install_property(gobject_class, PROP_MAX_THREADS,
+			g_param_spec_int("max-threads", "Maximum threads",
+				"Maximum number of decoding threads (0 = automatic for codecs that need it)",
+				0, 64, 0, G_PARAM_READWRITE));
+
+	g_object_class_install_property(gobject_class, PROP_CACHE_SIZE,
+			g_param_spec_uint64("cache-size", "Cache size",
+				"Memory for caching decoded frames, replayed after seeks (0 = disabled)",
+				0, G_MAXUINT64, 0, G_PARAM_READWRITE));
+
+	g_object_class_install_property(gobject_class, PROP_CACHE_HIT_RATE,
+			g_param_spec_double("cache-hit-rate", "Cache hit rate",
+				"Ratio of frames found in the cache after seeks",
+				0.0, 1.0, 0.0, G_PARAM_READABLE));
+
+	g_object_class_install_property(gobject_class, PROP_SEEK_LATENCY,
+			g_param_spec_int64("seek-latency", "Seek latency",
+				"Observed time from the last flush to the first frame pushed after it (us), "
+				"upstream included; not a benchmark",
+				0, G_MAXINT64, 0, G_PARAM_READABLE));
+
+	g_object_class_install_property(gobject_class, PROP_ERROR_RECOVERY,
+			g_param_spec_enum("error-recovery", "Error recovery",
+				"What to do after a decoding error",
+				GST_AV_VDEC_RECOVERY_TYPE, RECOVERY_NONE, G_PARAM_READWRITE));
+
+	g_object_class_install_property(gobject_class, PROP_FRAMES_DISCARDED,
+			g_param_spec_uint("frames-discarded", "Frames discarded",
+				"Number of frames discarded after decoding errors",
+				0, G_MAXUINT, 0, G_PARAM_READABLE));
+
+	g_object_class_install_property(gobject_class, PROP_FAST_START,
+			g_param_spec_enum("fast-start", "Fast start",
+				"Where to start decoding a new stream",
+				GST_AV_VDEC_FAST_START_TYPE, FAST_START_NONE, G_PARAM_READWRITE));
+
+	g_object_class_install_property(gobject_class, PROP_JOIN_TIME,
+			g_param_spec_int64("join-time", "Join time",
+				"Time from the first buffer to the first frame (us)",
+				0, G_MAXINT64, 0, G_PARAM_READABLE));
+
+	g_object_class_install_property(gobject_class, PROP_JOIN_DISCARDED,
+			g_param_spec_uint("join-discarded", "Join discarded",
+				"Number of frames discarded before the fast-start sync point",
+				0, G_MAXUINT, 0, G_PARAM_READABLE));
+
+	g_object_class_install_property(gobject_class, PROP_POOL_SIZE,
+			g_param_spec_uint("context-pool-size", "Context pool size",
+				"Opened decoder contexts to keep for reuse by other streams (0 = disabled)",
+				0, 64, 0, G_PARAM_READWRITE));
+
+	g_object_class_install_property(gobject_class, PROP_REVERSE_MEMORY,
+			g_param_spec_uint64("reverse-memory", "Reverse playback memory",
+				"Maximum size of the frames held for reverse playback (bytes)",
+				0, G_MAXUINT64, 64 * 1024 * 1024, G_PARAM_READWRITE));
+
+	g_object_class_install_property(gobject_class, PROP_LOW_DELAY,
+			g_param_spec_boolean("low-delay", "Low delay",
+				"Output each frame as soon as its packet is decoded (no B-frames)",
+				FALSE, G_PARAM_READWRITE));
+
+	g_object_class_install_property(gobject_class, PROP_FRAME_LATENCY,
+			g_param_spec_int64("frame-latency", "Frame latency",
+				"Time from the last packet to its frame in low-delay mode (us)",
+				0, G_MAXINT64, 0, G_PARAM_READABLE));
+
+	g_object_class_install_property(gobject_class, PROP_BAND_EVENTS,
+			g_param_spec_boolean("band-events", "Band events",
+				"Send GstAVVideoBand events as rows of a frame are decoded",
+				FALSE, G_PARAM_READWRITE));
+
+	g_object_class_install_property(gobject_class, PROP_VERIFY,
+			g_param_spec_boolean("verify", "Verify",
+				"Only decode, and report a CRC-32C of each frame instead of pushing it",
+				FALSE, G_PARAM_READWRITE));
+
+	g_object_class_install_property(gobject_class, PROP_VERIFY_LOCATION,
+			g_param_spec_string("verify-location", "Verify location",
+				"File to write the checksums to, instead of posting messages",
+				NULL, G_PARAM_READWRITE));
+
+	g_object_class_install_property(gobject_class, PROP_OUTPUT_WIDTH,
+			g_param_spec_int("output-width", "Output width",
+				"Scale the frames to this width (0 = decoded width)",
+				0, G_MAXINT, 0, G_PARAM_READWRITE));
+
+	g_object_class_install_property(gobject_class, PROP_OUTPUT_HEIGHT,
+			g_param_spec_int("output-height", "Output height",
+				"Scale the frames to this height (0 = decoded height)",
+				0, G_MAXINT, 0, G_PARAM_READWRITE));
 }
 
 GType
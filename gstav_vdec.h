@@ -13,6 +13,10 @@
 #include <gst/gst.h>
 #include <libavcodec/avcodec.h>
 #include <stdbool.h>
+#include <stdio.h>
+
+#include "gstav_cache.h"
+#include "plugin.h"
 
 #define GST_AV_VDEC_TYPE (gst_av_vdec_get_type())
 
@@ -23,9 +27,70 @@ struct gst_av_vdec {
 	GstPad *sinkpad, *srcpad;
 	AVCodec *codec;
 	AVCodecContext *av_ctx;
+	bool opened;
+	unsigned pool_size;
+	struct gst_av_pool_key pool_key;
 	bool initialized;
 	bool (*parse_func)(struct gst_av_vdec *vdec, GstBuffer *buf);
+	int nal_length_size;
+	bool nal_aligned;
+	bool vcl_seen;
+	bool au_new;
 	GMutex mutex;
+	gint flushing;
+	gint64 flush_time;
+	gint64 seek_latency;
+	int max_threads;
+	guint32 fourcc;
+	int width, height;
+	int out_width, out_height;
+	struct SwsContext *sws;
+	GstIndex *index;
+	gint index_id;
+	GstSegment segment;
+	int64_t delay_pts[16];
+	unsigned packets;
+	int max_delay, reported_delay;
+	bool low_delay;
+	bool band_events;
+	bool verify;
+	char *verify_location;
+	FILE *verify_file;
+	guint64 verify_frames;
+	gint64 chain_start;
+	gint64 frame_latency;
+	bool preroll;
+	enum AVDiscard discard;
+	bool seek_skip;
+	GstClockTime last_key;
+	GstClockTime last_out;
+
+	/* reverse playback */
+	GQueue gop;
+	GQueue rev_frames;
+	guint64 rev_bytes, rev_max_bytes;
+	int rev_idx, rev_lo, rev_hi;
+
+	/* error recovery */
+	int recovery;
+	bool waiting_sync;
+	unsigned discarded, total_discarded;
+
+	/* fast start */
+	int fast_start;
+	int skip_frames;
+	bool joining;
+	unsigned join_discarded;
+	gint64 join_start;
+	gint64 join_time;
+
+	/* decoded frame cache */
+	struct gst_av_cache *cache;
+	guint64 cache_size;
+	bool replay;
+	GstClockTime replay_last;
+	GQueue replay_pkts;
+	guint64 cache_hits, cache_misses;
 
 	/* thank you GStreamer */
 	bool is_dts;
@@ -28,6 +28,38 @@ struct obj_class {
 	GstElementClass parent_class;
 };
 
+/*
+ * The delay is the frames that went in after the one a packet came from,
+ * lookahead and threads included. Frames the encoder fails on don't add up.
+ */
+static void count_frame(struct obj *self, int64_t pts)
+{
+	self->delay_pts[self->frames++ % ARRAY_SIZE(self->delay_pts)] = pts;
+}
+
+static void count_packet(struct obj *self, int64_t pts)
+{
+	unsigned n = MIN(self->frames, ARRAY_SIZE(self->delay_pts));
+	int delay = -1;
+
+	if (pts == (int64_t)AV_NOPTS_VALUE)
+		return;
+
+	for (unsigned i = 1; i <= n; i++) {
+		if (self->delay_pts[(self->frames - i) % ARRAY_SIZE(self->delay_pts)] == pts) {
+			delay = i - 1;
+			break;
+		}
+	}
+
+	if (delay > self->max_delay) {
+		self->max_delay = delay;
+		if (self->max_delay > self->reported_delay)
+			gst_element_post_message(GST_ELEMENT(self),
+					gst_message_new_latency(GST_OBJECT(self)));
+	}
+}
+
 static GstFlowReturn
 pad_chain(GstPad *pad, GstBuffer *buf)
 {
@@ -87,6 +119,7 @@ pad_chain(GstPad *pad, GstBuffer *buf)
 			ctx->width, ctx->height);
 
 	frame->pts = gstav_timestamp_to_pts(ctx, buf->timestamp);
+	count_frame(self, frame->pts);
 
 #if LIBAVCODEC_VERSION_MAJOR >= 55
 	av_init_packet(&pkt);
@@ -117,6 +150,8 @@ pad_chain(GstPad *pad, GstBuffer *buf)
 	pts = ctx->coded_frame->pts;
 #endif
 
+	count_packet(self, pts);
+
 	out_buf = gst_buffer_new_and_alloc(read);
 	memcpy(out_buf->data, self->buffer, read);
 	gst_buffer_set_caps(out_buf, self->srcpad->caps);
@@ -134,6 +169,58 @@ leave:
 	return ret;
 }
 
+static gboolean src_query(GstPad *pad, GstQuery *query)
+{
+	struct obj *self;
+	gboolean ret;
+
+	self = (struct obj *)(gst_pad_get_parent(pad));
+
+	switch (GST_QUERY_TYPE(query)) {
+	case GST_QUERY_LATENCY: {
+		AVCodecContext *ctx = self->av_ctx;
+		gboolean live;
+		GstClockTime min, max, latency = 0;
+		int delay = self->max_delay;
+
+		ret = gst_pad_peer_query(self->sinkpad, query);
+		if (!ret)
+			goto leave;
+
+		gst_query_parse_latency(query, &live, &min, &max);
+
+		if (ctx) {
+			/* until the first packet, what the encoder says */
+			delay = MAX(delay, ctx->delay);
+			delay = MAX(delay, ctx->has_b_frames);
+			if (ctx->time_base.den)
+				latency = gst_util_uint64_scale(delay * GST_SECOND,
+						ctx->time_base.num, ctx->time_base.den);
+		}
+		self->reported_delay = delay;
+
+		GST_DEBUG_OBJECT(self, "latency %" GST_TIME_FORMAT " (%i frames)",
+				GST_TIME_ARGS(latency), delay);
+
+		min += latency;
+		if (GST_CLOCK_TIME_IS_VALID(max))
+			max += latency;
+
+		gst_query_set_latency(query, live, min, max);
+		goto leave;
+	}
+	default:
+		break;
+	}
+
+	ret = gst_pad_query_default(pad, query);
+
+leave:
+	gst_object_unref(self);
+
+	return ret;
+}
+
 static GstStateChangeReturn
 change_state(GstElement *element, GstStateChange transition)
 {
@@ -145,6 +232,7 @@ change_state(GstElement *element, GstStateChange transition)
 	switch (transition) {
 	case GST_STATE_CHANGE_NULL_TO_READY:
 		self->initialized = false;
+		self->frames = self->max_delay = 0;
 		break;
 
 	default:
@@ -226,6 +314,7 @@ instance_init(GTypeInstance *instance, void *g_class)
 	self->srcpad =
 		gst_pad_new_from_template(gst_element_class_get_pad_template(element_class, "src"), "src");
 
+	gst_pad_set_query_function(self->srcpad, src_query);
 	gst_pad_use_fixed_caps(self->srcpad);
 
 	gst_element_add_pad((GstElement *)self, self->sinkpad);
@@ -28,6 +28,9 @@ struct gst_av_venc {
 	void (*init_ctx)(struct gst_av_venc *base, AVCodecContext *ctx);
 	uint8_t *buffer;
 	size_t buffer_size;
+	int64_t delay_pts[16];
+	unsigned frames;
+	int max_delay, reported_delay;
 };
 
 #endif /* GST_AV_VENC_H */
@@ -15,6 +15,7 @@
 #include "gstav_h264enc.h"
 
 #include <stdbool.h>
+#include <string.h>
 
 GstDebugCategory *gstav_debug;
 
@@ -42,6 +43,146 @@ int gst_av_codec_close(AVCodecContext *avctx)
 	return ret;
 }
 
+/*
+ * Opened contexts that were given back, most recent first. They are
+ * flushed, so they can be reused by any stream with the same
+ * configuration.
+ */
+static GStaticMutex gst_av_pool_mutex = G_STATIC_MUTEX_INIT;
+static GQueue gst_av_pool = G_QUEUE_INIT;
+static unsigned gst_av_pool_users;
+
+/* for all elements */
+#define POOL_MAX 64
+
+struct pool_entry {
+	AVCodecContext *avctx;
+	struct gst_av_pool_key key;
+};
+
+void gst_av_codec_pool_key(AVCodecContext *config, struct gst_av_pool_key *key)
+{
+	key->thread_count = config->thread_count;
+#if !defined(FF_API_LOWRES) || FF_API_LOWRES
+	key->lowres = config->lowres;
+#else
+	key->lowres = 0;
+#endif
+}
+
+/* everything the open depends on */
+static bool pool_match(struct pool_entry *e, AVCodecContext *b)
+{
+	AVCodecContext *a = e->avctx;
+	struct gst_av_pool_key key;
+
+	/* the opened context has these resolved */
+	gst_av_codec_pool_key(b, &key);
+	if (e->key.thread_count != key.thread_count || e->key.lowres != key.lowres)
+		return false;
+
+	if (a->codec_id != b->codec_id)
+		return false;
+	if (a->flags != b->flags || a->flags2 != b->flags2)
+		return false;
+	if (a->thread_type != b->thread_type)
+		return false;
+	if (a->draw_horiz_band != b->draw_horiz_band || a->slice_flags != b->slice_flags)
+		return false;
+	if (a->skip_loop_filter != b->skip_loop_filter || a->skip_idct != b->skip_idct)
+		return false;
+	if (a->idct_algo != b->idct_algo || a->workaround_bugs != b->workaround_bugs)
+		return false;
+	if (a->extradata_size != b->extradata_size)
+		return false;
+	if (a->extradata_size && memcmp(a->extradata, b->extradata, a->extradata_size))
+		return false;
+	return true;
+}
+
+AVCodecContext *gst_av_codec_pool_get(AVCodecContext *config)
+{
+	struct pool_entry *e = NULL;
+	AVCodecContext *avctx = NULL;
+	GList *l;
+
+	g_static_mutex_lock(&gst_av_pool_mutex);
+	for (l = gst_av_pool.head; l; l = l->next) {
+		if (pool_match(l->data, config)) {
+			e = l->data;
+			g_queue_delete_link(&gst_av_pool, l);
+			break;
+		}
+	}
+	g_static_mutex_unlock(&gst_av_pool_mutex);
+
+	if (e) {
+		avctx = e->avctx;
+		g_slice_free(struct pool_entry, e);
+	}
+
+	return avctx;
+}
+
+static void pool_free(GSList *list)
+{
+	for (GSList *l = list; l; l = l->next) {
+		struct pool_entry *e = l->data;
+		gst_av_codec_close(e->avctx);
+		av_freep(&e->avctx->extradata);
+		av_free(e->avctx);
+		g_slice_free(struct pool_entry, e);
+	}
+	g_slist_free(list);
+}
+
+void gst_av_codec_pool_put(AVCodecContext *avctx, const struct gst_av_pool_key *key,
+		unsigned max)
+{
+	struct pool_entry *e;
+	GSList *old = NULL;
+
+	avcodec_flush_buffers(avctx);
+	avctx->opaque = NULL;
+	/* set per packet */
+	avctx->skip_frame = AVDISCARD_DEFAULT;
+
+	e = g_slice_new(struct pool_entry);
+	e->avctx = avctx;
+	e->key = *key;
+
+	g_static_mutex_lock(&gst_av_pool_mutex);
+	g_queue_push_head(&gst_av_pool, e);
+	while (gst_av_pool.length > MIN(max, POOL_MAX))
+		old = g_slist_prepend(old, g_queue_pop_tail(&gst_av_pool));
+	g_static_mutex_unlock(&gst_av_pool_mutex);
+
+	pool_free(old);
+}
+
+void gst_av_codec_pool_ref(void)
+{
+	g_static_mutex_lock(&gst_av_pool_mutex);
+	gst_av_pool_users++;
+	g_static_mutex_unlock(&gst_av_pool_mutex);
+}
+
+/* 0.10 never unloads plugins, so the last element takes the pool down */
+void gst_av_codec_pool_unref(void)
+{
+	GSList *old = NULL;
+	struct pool_entry *e;
+
+	g_static_mutex_lock(&gst_av_pool_mutex);
+	if (--gst_av_pool_users == 0) {
+		while ((e = g_queue_pop_head(&gst_av_pool)))
+			old = g_slist_prepend(old, e);
+	}
+	g_static_mutex_unlock(&gst_av_pool_mutex);
+
+	pool_free(old);
+}
+
 static gboolean
 plugin_init(GstPlugin *plugin)
 {
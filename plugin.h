@@ -20,4 +20,17 @@ struct AVCodec;
 int gst_av_codec_open(struct AVCodecContext *avctx, struct AVCodec *codec);
 int gst_av_codec_close(struct AVCodecContext *avctx);
 
+/* what open() may rewrite, as requested */
+struct gst_av_pool_key {
+	int thread_count;
+	int lowres;
+};
+
+void gst_av_codec_pool_key(struct AVCodecContext *config, struct gst_av_pool_key *key);
+struct AVCodecContext *gst_av_codec_pool_get(struct AVCodecContext *config);
+void gst_av_codec_pool_put(struct AVCodecContext *avctx, const struct gst_av_pool_key *key,
+		unsigned max);
+void gst_av_codec_pool_ref(void);
+void gst_av_codec_pool_unref(void);
+
 #endif /* PLUGIN_H */
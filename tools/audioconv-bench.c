@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Author: agent <agent@local>
+ *
+ * This file may be used under the terms of the GNU Lesser General Public
+ * License version 2.1, a copy of which is found in LICENSE included in the
+ * packaging of this file.
+ */
+
+/*
+ * Times each audioconv kernel against the generic C version, and checks
+ * that the output is the same.
+ *
+ * usage: audioconv-bench [iterations]
+ */
+
+/* the kernels are static */
+#include "../gstav_audioconv.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SAMPLES 1024
+
+struct kernel {
+	const char *name;
+	bool available;
+	void (*interleave_16)(int16_t *dst, const int16_t *const *src, int channels, int samples);
+	void (*interleave_32)(int32_t *dst, const int32_t *const *src, int channels, int samples);
+	void (*planar_float_to_s16)(int16_t *dst, const float *const *src, int channels, int samples);
+};
+
+static struct kernel kernels[] = {
+	{ "c", true, interleave_16_c, interleave_32_c, planar_float_to_s16_c },
+#if defined(HAVE_X86)
+	{ "sse2", false, interleave_16_sse2, interleave_32_sse2, planar_float_to_s16_sse2 },
+	/* only the float conversion has an AVX2 version */
+	{ "avx2", false, NULL, NULL, planar_float_to_s16_avx2 },
+#elif defined(HAVE_NEON)
+	{ "neon", true, interleave_16_neon, interleave_32_neon, planar_float_to_s16_neon },
+#endif
+};
+
+enum op {
+	OP_INTERLEAVE_16,
+	OP_INTERLEAVE_32,
+	OP_FLOAT_TO_S16,
+};
+
+static const char *op_names[] = {
+	"S16 planar -> interleaved",
+	"S32 planar -> interleaved",
+	"float planar -> S16",
+};
+
+static int16_t *src_16[8];
+static int32_t *src_32[8];
+static float *src_float[8];
+
+static void fill_sources(void)
+{
+	for (int c = 0; c < 8; c++) {
+		src_16[c] = malloc(SAMPLES * sizeof(*src_16[c]));
+		src_32[c] = malloc(SAMPLES * sizeof(*src_32[c]));
+		src_float[c] = malloc(SAMPLES * sizeof(*src_float[c]));
+		for (int i = 0; i < SAMPLES; i++) {
+			int v = rand();
+			src_16[c][i] = v;
+			src_32[c][i] = v;
+			/* some out of range, to go through the clipping */
+			src_float[c][i] = (float)v / RAND_MAX * 2.4f - 1.2f;
+		}
+	}
+}
+
+static bool has_op(struct kernel *k, enum op op)
+{
+	switch (op) {
+	case OP_INTERLEAVE_16:
+		return k->interleave_16;
+	case OP_INTERLEAVE_32:
+		return k->interleave_32;
+	default:
+		return k->planar_float_to_s16;
+	}
+}
+
+static void run(struct kernel *k, enum op op, void *dst, int channels)
+{
+	switch (op) {
+	case OP_INTERLEAVE_16:
+		k->interleave_16(dst, (const int16_t *const *)src_16, channels, SAMPLES);
+		break;
+	case OP_INTERLEAVE_32:
+		k->interleave_32(dst, (const int32_t *const *)src_32, channels, SAMPLES);
+		break;
+	default:
+		k->planar_float_to_s16(dst, (const float *const *)src_float, channels, SAMPLES);
+		break;
+	}
+}
+
+/* in us */
+static gint64 measure(struct kernel *k, enum op op, void *dst, int channels, int iterations)
+{
+	gint64 start;
+
+	/* warm up */
+	run(k, op, dst, channels);
+
+	start = g_get_monotonic_time();
+	for (int i = 0; i < iterations; i++)
+		run(k, op, dst, channels);
+
+	return g_get_monotonic_time() - start;
+}
+
+int main(int argc, char **argv)
+{
+	static const int channels[] = { 1, 2, 6, 8 };
+	int iterations = 20000;
+	int32_t *ref, *out;
+	int errors = 0;
+
+	if (argc > 1)
+		iterations = atoi(argv[1]);
+
+#if defined(HAVE_X86)
+	__builtin_cpu_init();
+	kernels[1].available = __builtin_cpu_supports("sse2");
+	kernels[2].available = __builtin_cpu_supports("avx2");
+#endif
+
+	fill_sources();
+	ref = malloc(8 * SAMPLES * sizeof(*ref));
+	out = malloc(8 * SAMPLES * sizeof(*out));
+
+	printf("%d x %d samples per channel, time in ms\n", iterations, SAMPLES);
+
+	for (enum op op = 0; op < G_N_ELEMENTS(op_names); op++) {
+		printf("\n%s\n", op_names[op]);
+
+		for (unsigned c = 0; c < G_N_ELEMENTS(channels); c++) {
+			size_t size = (op == OP_INTERLEAVE_32 ? 4 : 2) * channels[c] * SAMPLES;
+			gint64 base;
+
+			memset(ref, 0, size);
+			run(&kernels[0], op, ref, channels[c]);
+			base = measure(&kernels[0], op, ref, channels[c], iterations);
+
+			printf("  %d ch: c %.1f", channels[c], base / 1000.0);
+
+			for (unsigned i = 1; i < G_N_ELEMENTS(kernels); i++) {
+				struct kernel *k = &kernels[i];
+				gint64 t;
+
+				if (!k->available || !has_op(k, op))
+					continue;
+
+				memset(out, 0, size);
+				run(k, op, out, channels[c]);
+				if (memcmp(ref, out, size)) {
+					printf(", %s MISMATCH", k->name);
+					errors++;
+					continue;
+				}
+
+				t = measure(k, op, out, channels[c], iterations);
+				printf(", %s %.1f (%.1fx)", k->name, t / 1000.0, (double)base / t);
+			}
+			printf("\n");
+		}
+	}
+
+	free(ref);
+	free(out);
+
+	return errors ? 1 : 0;
+}
@@ -28,3 +28,75 @@ int64_t gstav_pts_to_timestamp(AVCodecContext *ctx, int64_t pts)
 		return -1;
 	return av_rescale_q(pts, ctx->time_base, bq);
 }
+
+/* CRC-32C (Castagnoli), reflected */
+
+static uint32_t crc32c_table[256];
+
+static void crc32c_init_table(void)
+{
+	for (unsigned i = 0; i < 256; i++) {
+		uint32_t c = i;
+		for (int j = 0; j < 8; j++)
+			c = (c >> 1) ^ (c & 1 ? 0x82f63b78 : 0);
+		crc32c_table[i] = c;
+	}
+}
+
+static uint32_t crc32c_sw(uint32_t crc, const uint8_t *p, size_t size)
+{
+	while (size--)
+		crc = crc32c_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	return crc;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_CRC32C_SSE42
+
+#include <nmmintrin.h>
+#include <string.h>
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const uint8_t *p, size_t size)
+{
+#ifdef __x86_64__
+	uint64_t c = crc;
+
+	for (; size >= 8; size -= 8, p += 8) {
+		uint64_t v;
+		memcpy(&v, p, 8);
+		c = _mm_crc32_u64(c, v);
+	}
+	crc = c;
+#endif
+	for (; size >= 4; size -= 4, p += 4) {
+		uint32_t v;
+		memcpy(&v, p, 4);
+		crc = _mm_crc32_u32(crc, v);
+	}
+	while (size--)
+		crc = _mm_crc32_u8(crc, *p++);
+	return crc;
+}
+#endif
+
+static uint32_t (*crc32c_func)(uint32_t crc, const uint8_t *p, size_t size);
+
+uint32_t gstav_crc32c(uint32_t crc, const void *data, size_t size)
+{
+	static gsize init;
+
+	if (g_once_init_enter(&init)) {
+		crc32c_func = crc32c_sw;
+#ifdef HAVE_CRC32C_SSE42
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("sse4.2"))
+			crc32c_func = crc32c_sse42;
+#endif
+		if (crc32c_func == crc32c_sw)
+			crc32c_init_table();
+		g_once_init_leave(&init, 1);
+	}
+
+	return ~crc32c_func(~crc, data, size);
+}
@@ -12,6 +12,7 @@
 #define UTIL_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 struct AVCodecContext;
 
@@ -20,4 +21,6 @@ struct AVCodecContext;
 int64_t gstav_timestamp_to_pts(struct AVCodecContext *ctx, int64_t ts);
 int64_t gstav_pts_to_timestamp(struct AVCodecContext *ctx, int64_t pts);
 
+uint32_t gstav_crc32c(uint32_t crc, const void *data, size_t size);
+
 #endif /* UTIL_H */